@@ -0,0 +1,354 @@
+/* ------------------------------ Steve Harvey Image Generator ------------------------------ */
+/* ---------------------------------------- Benchmark ---------------------------------------- */
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/utils/logger.hpp>
+#include <filesystem>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include "Image.h"
+#include "CompiledCascade.h"
+#include "StageTimings.h"
+#include "RunSettings.h"
+#include "InputSource.h"
+#include "Log.h"
+namespace fs = std::filesystem; // Requires C++17
+
+#define endlog Log::printStream()
+
+/* ---------------------------------------- Headers ---------------------------------------- */
+
+// One measured configuration
+struct BenchConfig {
+	std::string name;			// Metric prefix (ex: "single")
+	int threads = 1;
+};
+
+// Options : Defaults below, overridden on the command line
+struct BenchOptions {
+	std::vector<std::string> corpus;
+	int iterations = 3;			// Timed passes over the corpus per configuration
+	int warmup = 1;				// Untimed passes first : Loads classifiers per thread and fills the buffer pool
+	int threads = 0;			// Multi threaded configuration : 0 = One per core
+	bool compiled = false;		// Cascade::useCompiled
+	double threshold = 0.10;	// Relative change counted as a regression
+	double noiseFloorMs = 0.5;	// Latency changes smaller than this are never regressions
+	std::string baselinePath;	// Compare against
+	std::string savePath;		// Write this run's metrics as the new baseline
+};
+
+typedef std::map<std::string, double> Metrics; // Sorted so saved baselines diff cleanly
+
+bool parseArguments(int argc, char** argv, BenchOptions& options);
+std::vector<std::string> collectCorpus(const std::vector<std::string>& directories);
+void benchmarkCascadeLoad(const std::vector<std::string>& cascadePaths, Metrics& metrics);
+void benchmarkCorpus(const std::vector<std::string>& files, const BenchConfig& config, const BenchOptions& options, Metrics& metrics);
+void processImage(std::unique_ptr<Image>& image, const std::string& path, std::vector<uchar>& encoded);
+const char* benchStageName(TimingStage stage);
+bool loadMetrics(const std::string& path, Metrics& metrics);
+bool saveMetrics(const std::string& path, const Metrics& metrics);
+int compareMetrics(const Metrics& baseline, const Metrics& current, const BenchOptions& options);
+inline bool higherIsBetter(const std::string& metric);
+
+/* ---------------------------------------- SETTINGS ---------------------------------------- */
+
+// Run from the OpenCVProject folder : Cascade paths in Image are relative to it
+const std::vector<std::string> defaultCorpus = { "./Resources/Input/", "./Resources/Output/", "./Resources/Failures/" };
+
+// Same decode / detection settings main.cpp ships with
+const RunSettings runSettings;
+
+/* ---------------------------------------- Main ---------------------------------------- */
+
+/// <summary>
+/// Measure cascade load, decode, normalize, each cascade, render and encode over the bundled corpus,
+/// single threaded and with one Image per worker thread, then compare against a saved baseline.
+/// Exit code : 0 = ok, 1 = regression against the baseline, 2 = bad arguments / empty corpus
+/// </summary>
+int main(int argc, char** argv) {
+	using namespace std;
+	using namespace cv;
+	utils::logging::setLogLevel(utils::logging::LogLevel::LOG_LEVEL_ERROR);
+
+	BenchOptions options;
+	if (!parseArguments(argc, argv, options)) return 2;
+	if (options.corpus.empty()) options.corpus = defaultCorpus;
+
+	// Only errors and the report : Image's own logging would be timed otherwise
+	for (int channel = 0; channel < LOG_CHANNEL_COUNT; channel++) Log::blacklist((LogChannel)channel);
+	Log::whitelist(LOG_DEFAULT);
+	Log::whitelist(LOG_ERROR);
+
+	runSettings.applyProcess();
+	Cascade::useCompiled = options.compiled;
+
+	vector<string> files = collectCorpus(options.corpus);
+	if (files.empty()) {
+		Log::println("[ERROR] No images in corpus", LOG_ERROR);
+		Log::stop();
+		return 2;
+	}
+
+	int threads = (options.threads > 0) ? options.threads : max(1, (int)thread::hardware_concurrency());
+	startlog << "Benchmark : [" << files.size() << " Images] [" << options.iterations << " Iterations] [" << threads << " Threads] ["
+		<< (options.compiled ? "Compiled" : "XML") << " Cascades]" << endl << endlog;
+	Log::print("----------------------------------------\n");
+
+	Metrics metrics;
+	metrics["corpus.images"] = (double)files.size();
+	{
+		// Cascade paths come from an Image : Constructing it also checks the first file decodes
+		Image probe(files.front());
+		benchmarkCascadeLoad({ probe.faceCascade.path, probe.eyeCascade.path, probe.animeFaceCascade.path, probe.animeEyeCascade.path }, metrics);
+	}
+	benchmarkCorpus(files, BenchConfig{ "single", 1 }, options, metrics);
+	if (threads > 1) benchmarkCorpus(files, BenchConfig{ "multi", threads }, options, metrics);
+
+	int result = 0;
+	if (!options.baselinePath.empty()) {
+		Metrics baseline;
+		if (loadMetrics(options.baselinePath, baseline)) {
+			result = compareMetrics(baseline, metrics, options);
+		}
+		else {
+			Log::println("[ERROR] Could not read baseline \"" + options.baselinePath + "\"", LOG_ERROR);
+			result = 2;
+		}
+	}
+	if (!options.savePath.empty()) {
+		if (saveMetrics(options.savePath, metrics)) {
+			startlog << "Baseline Saved : \"" << options.savePath << "\"" << endl << endlog;
+		}
+		else {
+			Log::println("[ERROR] Could not write baseline \"" + options.savePath + "\"", LOG_ERROR);
+			result = max(result, 2);
+		}
+	}
+
+	Log::stop();
+	return result;
+}
+
+/* ---------------------------------------- Functions ---------------------------------------- */
+
+// --iterations N --warmup N --threads N --compiled --threshold F --noise-ms F --baseline PATH --save PATH --corpus DIR (repeatable)
+bool parseArguments(int argc, char** argv, BenchOptions& options) {
+	using namespace std;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+		if (arg == "--compiled") options.compiled = true;
+		else if (arg == "--iterations" && hasValue) options.iterations = max(1, atoi(argv[++i]));
+		else if (arg == "--warmup" && hasValue) options.warmup = max(0, atoi(argv[++i]));
+		else if (arg == "--threads" && hasValue) options.threads = max(0, atoi(argv[++i]));
+		else if (arg == "--threshold" && hasValue) options.threshold = atof(argv[++i]);
+		else if (arg == "--noise-ms" && hasValue) options.noiseFloorMs = atof(argv[++i]);
+		else if (arg == "--baseline" && hasValue) options.baselinePath = argv[++i];
+		else if (arg == "--save" && hasValue) options.savePath = argv[++i];
+		else if (arg == "--corpus" && hasValue) options.corpus.push_back(argv[++i]);
+		else {
+			Log::println("[ERROR] Unknown argument \"" + arg + "\"", LOG_ERROR);
+			Log::println("Usage : Benchmark [--iterations N] [--warmup N] [--threads N] [--compiled] [--threshold F] [--noise-ms F] [--baseline PATH] [--save PATH] [--corpus DIR]...", LOG_ERROR);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Image files of every directory, sorted so runs see the same order
+std::vector<std::string> collectCorpus(const std::vector<std::string>& directories) {
+	using namespace std;
+	vector<string> files;
+	for (const string& directory : directories) {
+		error_code error;
+		for (const auto& dirItem : fs::directory_iterator(directory, error)) {
+			string pathName = dirItem.path().string();
+			if (dirItem.is_regular_file() && InputSource::validExtension(pathName)) files.push_back(pathName);
+		}
+		if (error) Log::println("[ERROR] Could not read corpus directory \"" + directory + "\"", LOG_ERROR);
+	}
+	sort(files.begin(), files.end());
+	return files;
+}
+
+// Cold XML parse of each cascade, and mapping its .hcc (compiled first so the map measures a warm start)
+void benchmarkCascadeLoad(const std::vector<std::string>& cascadePaths, Metrics& metrics) {
+	using namespace std;
+	using namespace cv;
+
+	double xmlMs = 0, compiledMs = 0;
+	for (const string& path : cascadePaths) {
+		auto start = chrono::steady_clock::now();
+		CascadeClassifier classifier;
+		classifier.load(path);
+		xmlMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		CompiledCascade::load(path); // Writes the .hcc if it is missing or stale
+		start = chrono::steady_clock::now();
+		shared_ptr<CompiledCascade> compiled = CompiledCascade::load(path);
+		compiledMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+	metrics["cascade_load.xml_ms"] = xmlMs;
+	metrics["cascade_load.compiled_ms"] = compiledMs;
+
+	startlog << fixed << setprecision(2);
+	startlog << "[cascade load] xml " << xmlMs << " ms : compiled " << compiledMs << " ms (" << cascadePaths.size() << " cascades)" << endl << endlog;
+	startlog << defaultfloat << setprecision(6);
+}
+
+/// <summary>
+/// Run the corpus options.iterations times with config.threads workers, each reusing one Image.
+/// Workers take the next file from a shared counter, so the pass finishes together regardless of image size.
+/// </summary>
+void benchmarkCorpus(const std::vector<std::string>& files, const BenchConfig& config, const BenchOptions& options, Metrics& metrics) {
+	using namespace std;
+
+	TimingReport report;
+	size_t passes = (size_t)(options.warmup + options.iterations);
+	size_t warmupJobs = (size_t)options.warmup * files.size();
+	size_t totalJobs = passes * files.size();
+	atomic<size_t> nextJob = 0;
+	atomic<size_t> finishedWarmup = 0;
+	chrono::steady_clock::time_point timedStart;
+	atomic<bool> timing = (warmupJobs == 0);
+	if (timing) timedStart = chrono::steady_clock::now();
+
+	// Timed part starts once every warmup job has finished : Jobs are handed out in order, so none of them overlap it
+	auto worker = [&]() {
+		unique_ptr<Image> image;
+		vector<uchar> encoded;
+		for (size_t job = nextJob++; job < totalJobs; job = nextJob++) {
+			if (job >= warmupJobs) {
+				while (!timing) this_thread::yield();
+			}
+			processImage(image, files[job % files.size()], encoded);
+			if (job < warmupJobs) {
+				if (++finishedWarmup == warmupJobs) {
+					timedStart = chrono::steady_clock::now();
+					timing = true;
+				}
+			}
+			else {
+				report.add(image->timings);
+			}
+		}
+	};
+
+	vector<thread> workers;
+	for (int t = 1; t < config.threads; t++) workers.emplace_back(worker);
+	worker();
+	for (thread& t : workers) t.join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - timedStart).count();
+
+	double imagesPerSecond = (seconds > 0) ? report.size() / seconds : 0;
+	metrics[config.name + ".images_per_sec"] = imagesPerSecond;
+
+	startlog << fixed << setprecision(2);
+	startlog << "[" << config.name << "] " << config.threads << " threads : " << imagesPerSecond << " images/sec (" << report.size() << " images in " << seconds << " s)" << endl << endlog;
+	for (int stage = 0; stage <= STAGE_COUNT; stage++) {
+		StageSummary summary = (stage == STAGE_COUNT) ? report.summarizeTotal() : report.summarize((TimingStage)stage);
+		if (!summary.count) continue;
+		string key = config.name + "." + benchStageName((TimingStage)stage);
+		metrics[key + ".p50_ms"] = summary.p50;
+		metrics[key + ".p95_ms"] = summary.p95;
+		metrics[key + ".p99_ms"] = summary.p99;
+		metrics[key + ".max_ms"] = summary.max;
+		startlog << "    [" << benchStageName((TimingStage)stage) << "] p50 " << summary.p50 << " : p95 " << summary.p95
+			<< " : p99 " << summary.p99 << " : max " << summary.max << " (" << summary.count << ")" << endl << endlog;
+	}
+	startlog << defaultfloat << setprecision(6);
+	Log::print("----------------------------------------\n");
+}
+
+// Decode -> normalize -> grayscale -> cascades -> render -> encode (in memory : Disk speed is not what is measured)
+void processImage(std::unique_ptr<Image>& image, const std::string& path, std::vector<uchar>& encoded) {
+	if (image) image->loadImage(path);
+	else image = std::make_unique<Image>(path);
+	image->debugDrawing = false;
+	runSettings.apply(*image);
+
+	image->generateAll();
+	if (!image->checkForNormalized) return; // Could not decode : Only the decode time counts
+
+	StageTimer timer(image->timings.microseconds[STAGE_WRITE]);
+	cv::imencode(image->ext, image->checkForFaceImage ? image->faceImage : image->normalized, encoded);
+}
+
+// TimingReport names, except the write stage : It only encodes here
+const char* benchStageName(TimingStage stage) {
+	if (stage == STAGE_WRITE) return "encode";
+	if (stage == STAGE_COUNT) return "total";
+	return TimingReport::stageName(stage);
+}
+
+// ------------------------------- Baseline --------------------------------- //
+// Baseline file : One "metric value" pair per line
+bool loadMetrics(const std::string& path, Metrics& metrics) {
+	std::ifstream in(path);
+	if (!in) return false;
+	std::string metric;
+	double value;
+	while (in >> metric >> value) metrics[metric] = value;
+	return !metrics.empty();
+}
+
+bool saveMetrics(const std::string& path, const Metrics& metrics) {
+	std::ofstream out(path);
+	if (!out) return false;
+	out << std::fixed << std::setprecision(4);
+	for (const auto& [metric, value] : metrics) out << metric << " " << value << "\n";
+	return (bool)out;
+}
+
+/// <summary>
+/// Flag every metric that moved the wrong way by more than options.threshold (relative).
+/// Latencies also have to move by more than options.noiseFloorMs, so sub millisecond stages cannot fail a run on jitter.
+/// Metrics only in one of the two sets are skipped (ex: "multi" measured on a machine with another core count).
+/// </summary>
+/// <returns> 1 if anything regressed, else 0 </returns>
+int compareMetrics(const Metrics& baseline, const Metrics& current, const BenchOptions& options) {
+	using namespace std;
+
+	int regressions = 0, compared = 0;
+	startlog << "Baseline : \"" << options.baselinePath << "\" [" << options.threshold * 100 << "% Threshold]" << endl << endlog;
+	startlog << fixed << setprecision(2);
+	for (const auto& [metric, before] : baseline) {
+		auto found = current.find(metric);
+		if (found == current.end() || metric.starts_with("corpus.") || before <= 0) continue;
+		double after = found->second;
+		double change = (after - before) / before;
+		compared++;
+
+		bool regressed = higherIsBetter(metric)
+			? (change < -options.threshold)
+			: (change > options.threshold && after - before > options.noiseFloorMs);
+		if (regressed) {
+			regressions++;
+			startlog << "[REGRESSION] " << metric << " : " << before << " -> " << after << " (" << showpos << change * 100 << noshowpos << "%)" << endl << endlog;
+		}
+	}
+
+	auto images = baseline.find("corpus.images");
+	if (images != baseline.end() && images->second != current.at("corpus.images")) {
+		startlog << "[WARNING] Corpus size changed : " << images->second << " -> " << current.at("corpus.images") << " images" << endl << endlog;
+	}
+	startlog << "Compared : [" << compared << " Metrics] [" << regressions << " Regressions]" << endl << endlog;
+	startlog << defaultfloat << setprecision(6);
+	Log::print("----------------------------------------\n");
+	return regressions ? 1 : 0;
+}
+
+// Throughput goes up when things get faster, everything else is a time
+inline bool higherIsBetter(const std::string& metric) {
+	return metric.ends_with(".images_per_sec");
+}
@@ -0,0 +1,188 @@
+#include <iostream>
+#include <string>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+#pragma once
+
+using namespace std;
+
+/// <summary>
+/// Depth and stall counters for one queue between two pipeline stages.
+/// pushStall : Time producers waited on a full queue (downstream is slower)
+/// popStall : Time consumers waited on an empty queue (upstream is slower)
+/// </summary>
+struct QueueStats {
+    string name;
+    size_t capacity = 0;
+    size_t items = 0;
+    size_t maxDepth = 0;
+    double depthSum = 0;        // Depth seen by each push : depthSum / items = average depth
+    double pushStallMs = 0;
+    double popStallMs = 0;
+    size_t rejected = 0;        // tryPush() on a full queue
+
+    double averageDepth() const { return items ? depthSum / items : 0; }
+};
+
+/// <summary>
+/// Blocking FIFO with a fixed capacity : push() waits while full, pop() waits while empty.
+/// close() wakes everyone : pop() then drains what is left and returns false once empty.
+/// </summary>
+template <typename T>
+class BoundedQueue {
+private:
+    deque<T> items;
+    mutex queueMutex;
+    condition_variable notFull, notEmpty;
+    bool closed = false;
+    QueueStats queueStats;
+
+public:
+    BoundedQueue(string name, size_t capacity) {
+        queueStats.name = name;
+        queueStats.capacity = (capacity > 0) ? capacity : 1;
+    }
+
+    // False if the queue was closed before item could be added
+    bool push(T item) {
+        unique_lock<mutex> lock(queueMutex);
+        if (items.size() >= queueStats.capacity && !closed) {
+            auto start = chrono::steady_clock::now();
+            notFull.wait(lock, [&]() { return items.size() < queueStats.capacity || closed; });
+            queueStats.pushStallMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        }
+        if (closed) return false;
+
+        items.push_back(move(item));
+        queueStats.items++;
+        queueStats.depthSum += items.size();
+        queueStats.maxDepth = max(queueStats.maxDepth, items.size());
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Never waits : False if the queue is full or closed (item is left untouched so the caller can still answer it)
+    bool tryPush(T& item) {
+        unique_lock<mutex> lock(queueMutex);
+        if (closed || items.size() >= queueStats.capacity) {
+            if (!closed) queueStats.rejected++;
+            return false;
+        }
+
+        items.push_back(move(item));
+        queueStats.items++;
+        queueStats.depthSum += items.size();
+        queueStats.maxDepth = max(queueStats.maxDepth, items.size());
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // False once the queue is closed and empty
+    bool pop(T& item) {
+        unique_lock<mutex> lock(queueMutex);
+        if (items.empty() && !closed) {
+            auto start = chrono::steady_clock::now();
+            notEmpty.wait(lock, [&]() { return !items.empty() || closed; });
+            queueStats.popStallMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        }
+        if (items.empty()) return false;
+
+        item = move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    QueueStats stats() {
+        lock_guard<mutex> lock(queueMutex);
+        return queueStats;
+    }
+};
+
+/// <summary>
+/// Reorder buffer : Items are pushed by index in any order and popped strictly in index order.
+/// push(index) waits while index is capacity or more ahead of the next pop, so the lowest index is always accepted.
+/// close(count) marks the end of a stream whose length was not known up front : pop() returns false after index count - 1.
+/// </summary>
+template <typename T>
+class OrderedQueue {
+private:
+    map<size_t, T> items;
+    mutex queueMutex;
+    condition_variable notFull, notEmpty;
+    size_t nextIndex = 0;       // Next index pop() returns
+    size_t endIndex = SIZE_MAX; // close() : One past the last index
+    QueueStats queueStats;
+
+public:
+    OrderedQueue(string name, size_t capacity) {
+        queueStats.name = name;
+        queueStats.capacity = (capacity > 0) ? capacity : 1;
+    }
+
+    void push(size_t index, T item) {
+        unique_lock<mutex> lock(queueMutex);
+        if (index >= nextIndex + queueStats.capacity) {
+            auto start = chrono::steady_clock::now();
+            notFull.wait(lock, [&]() { return index < nextIndex + queueStats.capacity; });
+            queueStats.pushStallMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        }
+
+        items.emplace(index, move(item));
+        queueStats.items++;
+        queueStats.depthSum += items.size();
+        queueStats.maxDepth = max(queueStats.maxDepth, items.size());
+        lock.unlock();
+        notEmpty.notify_all();
+    }
+
+    // Waits for the next index in order : False once every index before close()'s count has been popped
+    bool pop(T& item) {
+        unique_lock<mutex> lock(queueMutex);
+        auto ready = [&]() { return nextIndex >= endIndex || (!items.empty() && items.begin()->first == nextIndex); };
+        if (!ready()) {
+            auto start = chrono::steady_clock::now();
+            notEmpty.wait(lock, ready);
+            queueStats.popStallMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        }
+        if (nextIndex >= endIndex) return false;
+
+        item = move(items.begin()->second);
+        items.erase(items.begin());
+        nextIndex++;
+        lock.unlock();
+        notFull.notify_all();
+        return true;
+    }
+
+    // No index at or after count will be pushed
+    void close(size_t count) {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            endIndex = count;
+        }
+        notEmpty.notify_all();
+    }
+
+    QueueStats stats() {
+        lock_guard<mutex> lock(queueMutex);
+        return queueStats;
+    }
+};
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <new>
+
+#include "BufferPool.h"
+
+using namespace std;
+using namespace cv;
+
+// Never destroyed : Mats held by statics may be released after main returns
+BufferPool& BufferPool::instance() {
+	static BufferPool* pool = new BufferPool();
+	return *pool;
+}
+
+// Same layout rules as OpenCV's default allocator, only the buffer (and its UMatData) come from the pool
+UMatData* BufferPool::allocate(int dims, const int* sizes, int type, void* data0, size_t* step, AccessFlag, UMatUsageFlags) const {
+	size_t total = CV_ELEM_SIZE(type);
+	for (int i = dims - 1; i >= 0; i--) {
+		if (step) {
+			if (data0 && step[i] != CV_AUTOSTEP) {
+				CV_Assert(total <= step[i]);
+				total = step[i];
+			}
+			else {
+				step[i] = total;
+			}
+		}
+		total *= sizes[i];
+	}
+
+	uchar* data = data0 ? (uchar*)data0 : take(capacityFor(total));
+
+	void* record = nullptr;
+	{
+		lock_guard<mutex> lock(poolMutex);
+		if (!freeRecords.empty()) {
+			record = freeRecords.back();
+			freeRecords.pop_back();
+		}
+	}
+	if (!record) record = ::operator new(sizeof(UMatData));
+
+	UMatData* u = new (record) UMatData(this);
+	u->data = u->origdata = data;
+	u->size = total;
+	if (data0) u->flags |= UMatData::USER_ALLOCATED;
+	return u;
+}
+
+bool BufferPool::allocate(UMatData* u, AccessFlag, UMatUsageFlags) const {
+	return u != nullptr;
+}
+
+void BufferPool::deallocate(UMatData* u) const {
+	if (!u) return;
+
+	CV_Assert(u->urefcount == 0);
+	CV_Assert(u->refcount == 0);
+	if (!(u->flags & UMatData::USER_ALLOCATED)) {
+		give(u->origdata, capacityFor(u->size));
+		u->origdata = 0;
+	}
+	u->~UMatData();
+
+	lock_guard<mutex> lock(poolMutex);
+	freeRecords.push_back(u);
+}
+
+BufferPool::Stats BufferPool::stats() const {
+	lock_guard<mutex> lock(poolMutex);
+	return poolStats;
+}
+
+// Return every cached buffer to the heap (live Mats are untouched)
+void BufferPool::trim() {
+	lock_guard<mutex> lock(poolMutex);
+	for (auto& [capacity, blocks] : freeBlocks) {
+		for (uchar* block : blocks) fastFree(block);
+		poolStats.cachedBytes -= capacity * blocks.size();
+	}
+	freeBlocks.clear();
+	for (void* record : freeRecords) ::operator delete(record);
+	freeRecords.clear();
+}
+
+// Power of two bucket : Frames of similar size (ex: 720 x 540 and 720 x 720) share one
+size_t BufferPool::capacityFor(size_t size) {
+	size_t capacity = MIN_CAPACITY;
+	while (capacity < size) capacity *= 2;
+	return capacity;
+}
+
+uchar* BufferPool::take(size_t capacity) const {
+	{
+		lock_guard<mutex> lock(poolMutex);
+		auto bucket = freeBlocks.find(capacity);
+		if (bucket != freeBlocks.end() && !bucket->second.empty()) {
+			uchar* block = bucket->second.back();
+			bucket->second.pop_back();
+			poolStats.reuses++;
+			poolStats.cachedBytes -= capacity;
+			poolStats.liveBytes += capacity;
+			return block;
+		}
+		poolStats.allocations++;
+		poolStats.liveBytes += capacity;
+		poolStats.peakBytes = max(poolStats.peakBytes, poolStats.liveBytes + poolStats.cachedBytes);
+	}
+	return (uchar*)fastMalloc(capacity);
+}
+
+void BufferPool::give(uchar* data, size_t capacity) const {
+	{
+		lock_guard<mutex> lock(poolMutex);
+		poolStats.liveBytes -= capacity;
+		vector<uchar*>& bucket = freeBlocks[capacity];
+		if (bucket.size() < MAX_BLOCKS_PER_SIZE) {
+			bucket.push_back(data);
+			poolStats.cachedBytes += capacity;
+			return;
+		}
+	}
+	fastFree(data);
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <map>
+#include <mutex>
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+/// <summary>
+/// Mat allocator that keeps freed buffers for reuse instead of returning them to the heap.
+/// Buffers are bucketed by power of two capacity, so once a batch has seen its largest image every
+/// Mat an Image needs (decode, normalize, grayscale, integrals, pyramid levels) comes from the cache.
+/// Install with Mat::setDefaultAllocator(&BufferPool::instance()) before any Mat is created.
+/// </summary>
+class BufferPool : public MatAllocator {
+public:
+    struct Stats {
+        size_t allocations = 0;     // Buffers taken from the heap
+        size_t reuses = 0;          // Buffers served from the cache
+        size_t cachedBytes = 0;     // Free buffers currently held
+        size_t liveBytes = 0;       // Buffers currently in use by Mats
+        size_t peakBytes = 0;       // Highest cached + live
+    };
+
+    static const size_t MIN_CAPACITY = 4096;
+    static const size_t MAX_BLOCKS_PER_SIZE = 16; // Extra frees of one size go back to the heap
+
+private:
+    mutable mutex poolMutex;
+    mutable map<size_t, vector<uchar*>> freeBlocks;  // Capacity -> free buffers
+    mutable vector<void*> freeRecords;              // UMatData storage
+    mutable Stats poolStats;
+
+public:
+    static BufferPool& instance();
+
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, AccessFlag flags, UMatUsageFlags usageFlags) const override;
+    bool allocate(UMatData* u, AccessFlag accessFlags, UMatUsageFlags usageFlags) const override;
+    void deallocate(UMatData* u) const override;
+
+    Stats stats() const;
+    void trim();
+
+private:
+    BufferPool() = default;
+
+    static size_t capacityFor(size_t size);
+    uchar* take(size_t capacity) const;
+    void give(uchar* data, size_t capacity) const;
+};
@@ -1,20 +1,145 @@
 #include <iostream> 
 #include <opencv2/opencv.hpp>
 #include <vector>
+#include <thread>
+#include <string>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
 
 #include "Cascade.h"
+#include "CascadeRegistry.h"
+#include "DetectionEngine.h"
 #include "Log.h"
 
 using namespace std;
 using namespace cv;
 
-void Cascade::detectMultiScale(Mat grayscaleImage) {
+bool Cascade::useCompiled = false;
+bool Cascade::verifyOpenCV = false;
+double Cascade::verifyOverlap = 0.5;
+atomic<long long> Cascade::referenceRects(0), Cascade::compiledRects(0), Cascade::matchedRects(0);
 
+// Shared classifier for path : Loaded through the registry the first time this cascade runs on a thread
+CascadeClassifier& Cascade::classifier() {
+	if (!cascade || cascadeThread != this_thread::get_id()) {
+		cascade = CascadeRegistry::get(path);
+		cascadeThread = this_thread::get_id();
+	}
+	return *cascade;
+}
+
+// Shared compiled cascade for path : nullptr if it could not be compiled
+CompiledCascade* Cascade::compiledClassifier() {
+	if (!compiled) {
+		compiled = CascadeRegistry::getCompiled(path);
+	}
+	return compiled.get();
+}
+
+void Cascade::detectMultiScale(Mat grayscaleImage) {
 	if (!scaleFactor && !minNeighbors && (minSize == Size(0, 0))) {
-		Log::stream << "Apply Settings to Cascade" << endl << Log::printStream();
+		startlog << "Apply Settings to Cascade" << endl << Log::printStream();
+	}
+
+	if (useCompiled && compiledClassifier()) {
+		{
+			StageTimer timer(detectMicroseconds);
+			compiled->detectMultiScale(grayscaleImage, rects, scaleFactor, minNeighbors, minSize);
+		}
+		if (verifyOpenCV) verifyRects(grayscaleImage, rects); // Not part of the detection time
+		return;
+	}
+	StageTimer timer(detectMicroseconds);
+	classifier().detectMultiScale(grayscaleImage, rects, scaleFactor, minNeighbors, 0, minSize);
+}
+
+/// <summary>
+/// Run OpenCV's CascadeClassifier with this cascade's settings and match its (grouped) rects to found one to one :
+/// Each OpenCV rect takes the unmatched compiled rect it overlaps most, a match needs IoU >= verifyOverlap. Counts go to the static totals.
+/// </summary>
+/// <param name="found"> Compiled rects for grayscaleImage (before any mapping to a parent image) </param>
+void Cascade::verifyRects(Mat grayscaleImage, const vector<Rect>& found) {
+	vector<Rect> reference;
+	classifier().detectMultiScale(grayscaleImage, reference, scaleFactor, minNeighbors, 0, minSize);
+
+	vector<bool> used(found.size(), false);
+	int matched = 0;
+	for (const Rect& expected : reference) {
+		int best = -1;
+		double bestOverlap = 0;
+		for (size_t i = 0; i < found.size(); i++) {
+			if (used[i]) continue;
+			double overlap = (expected & found[i]).area();
+			double iou = overlap / (expected.area() + found[i].area() - overlap);
+			if (iou > bestOverlap) {
+				bestOverlap = iou;
+				best = (int)i;
+			}
+		}
+		if (best >= 0 && bestOverlap >= verifyOverlap) {
+			used[best] = true;
+			matched++;
+		}
 	}
 
-	cascade.detectMultiScale(grayscaleImage, rects, scaleFactor, minNeighbors, 0, minSize);
+	referenceRects += reference.size();
+	compiledRects += found.size();
+	matchedRects += matched;
+	if (matched != (int)reference.size() || matched != (int)found.size()) {
+		logto(LOG_DETECTION) << "[OpenCV Verify] " << path << " : " << reference.size() << " OpenCV / " << found.size() << " compiled / " << matched << " matched" << endl << Log::printStream();
+	}
+}
+
+/// <summary>
+/// detectMultiScale only inside the upper part of each region, rects are mapped back to image space.
+/// Overlapping regions are merged when their bounding box is no bigger than scanning both, otherwise each is scanned on its own
+/// (only the overlap is scanned twice, and rects found twice there are dropped). No regions = no detection.
+/// </summary>
+/// <param name="regions"> Search areas in image space (ex: face rects) </param>
+/// <param name="upperFraction"> Part of each region's height to search from the top </param>
+void Cascade::detectInRegions(Mat grayscaleImage, const vector<Rect>& regions, double upperFraction) {
+	rects.clear();
+	Rect bounds = Rect(0, 0, grayscaleImage.cols, grayscaleImage.rows);
+
+	// Search areas :
+	vector<Rect> areas;
+	for (Rect region : regions) {
+		region.height = (int)(region.height * upperFraction);
+		region = region & bounds;
+		if (region.area() > 0) areas.push_back(region);
+	}
+	// Merge overlapping areas : Until no pair changes, a grown area may now overlap any other
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (size_t i = 0; i < areas.size() && !merged; i++) {
+			for (size_t j = i + 1; j < areas.size(); j++) {
+				Rect both = areas[i] | areas[j];
+				if ((areas[i] & areas[j]).area() > 0 && both.area() <= areas[i].area() + areas[j].area()) {
+					areas[i] = both;
+					areas.erase(areas.begin() + j);
+					merged = true;
+					break;
+				}
+			}
+		}
+	}
+
+	vector<Rect> found;
+	for (Rect area : areas) {
+		detectMultiScale(grayscaleImage(area));
+		for (Rect rect : rects) {
+			Rect mapped = Rect(rect.x + area.x, rect.y + area.y, rect.width, rect.height);
+			// Same object found again in an overlap scanned by two areas :
+			bool duplicate = any_of(found.begin(), found.end(), [&](const Rect& other) {
+				int overlap = (mapped & other).area();
+				return overlap * 2 >= mapped.area() + other.area() - overlap; // IoU >= 0.5
+			});
+			if (!duplicate) found.push_back(mapped);
+		}
+	}
+	rects.swap(found);
 }
 
 void Cascade::settings(double _scaleFactor, int _minNeighbors, Size _minSize) {
@@ -24,5 +149,57 @@ void Cascade::settings(double _scaleFactor, int _minNeighbors, Size _minSize) {
 }
 
 void Cascade::generateDebugAllCascades(Mat grayscaleImage) {
-	cascade.detectMultiScale(grayscaleImage, debugRects, 1.1, 0, 0);
-}
\ No newline at end of file
+	if (useCompiled && compiledClassifier()) {
+		compiled->detectMultiScale(grayscaleImage, debugRects, 1.1, 0);
+		return;
+	}
+	classifier().detectMultiScale(grayscaleImage, debugRects, 1.1, 0, 0);
+}
+
+// Everything that decides this cascade's rects besides the image : File (size / time catch a retrained cascade), evaluator and settings
+string Cascade::identity() const {
+	error_code error;
+	uintmax_t fileSize = filesystem::file_size(path, error);
+	long long fileTime = filesystem::last_write_time(path, error).time_since_epoch().count();
+	ostringstream text;
+	text << path << ":" << fileSize << ":" << fileTime << ":" << useCompiled << ":" << scaleFactor << ":" << minNeighbors << ":" << minSize.width << "x" << minSize.height;
+	return text.str();
+}
+
+/// <summary>
+/// detectMultiScale (or generateDebugAllCascades) for several cascades over one shared pyramid.
+/// Only the compiled evaluator can scan a prebuilt pyramid : Without useCompiled each cascade runs on its own.
+/// </summary>
+void Cascade::detectShared(Mat grayscaleImage, const vector<Cascade*>& cascades, bool debugAll) {
+	bool shared = useCompiled;
+	for (Cascade* cascade : cascades) {
+		shared = shared && cascade->compiledClassifier();
+	}
+
+	if (!shared) {
+		for (Cascade* cascade : cascades) {
+			if (debugAll) cascade->generateDebugAllCascades(grayscaleImage);
+			else cascade->detectMultiScale(grayscaleImage);
+		}
+		return;
+	}
+
+	vector<DetectionJob> jobs;
+	for (Cascade* cascade : cascades) {
+		DetectionJob job;
+		job.cascade = cascade->compiled.get();
+		job.scaleFactor = debugAll ? 1.1 : cascade->scaleFactor;
+		job.minNeighbors = debugAll ? 0 : cascade->minNeighbors;
+		job.minSize = debugAll ? Size() : cascade->minSize;
+		job.rects = debugAll ? &cascade->debugRects : &cascade->rects;
+		jobs.push_back(job);
+	}
+	DetectionEngine::run(grayscaleImage, jobs);
+
+	// Debug scans are not part of the image's detection time
+	if (debugAll) return;
+	for (size_t i = 0; i < cascades.size(); i++) {
+		cascades[i]->detectMicroseconds = max(cascades[i]->detectMicroseconds, 0LL) + jobs[i].microseconds;
+		if (verifyOpenCV) cascades[i]->verifyRects(grayscaleImage, cascades[i]->rects);
+	}
+}
@@ -2,6 +2,12 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "CompiledCascade.h"
+#include "StageTimings.h"
 
 #pragma once
 
@@ -13,7 +19,9 @@ class Cascade {
 public:
     vector<Rect> rects;
     vector<Rect> debugRects;
-    CascadeClassifier cascade;
+    shared_ptr<CascadeClassifier> cascade;  // Shared through CascadeRegistry : Loaded on first use
+    thread::id cascadeThread;               // Thread cascade belongs to : Refetched when run on another thread
+    shared_ptr<CompiledCascade> compiled;   // Shared through CascadeRegistry : Mapped on first use
     string path;
     Scalar color = Scalar(255, 255, 255);
 
@@ -21,14 +29,29 @@ public:
     int minNeighbors = 0;
     Size minSize = Size(0,0);
 
+    long long detectMicroseconds = -1;      // detectMultiScale time for the current image : -1 = not run (Image resets it)
+
+    static bool useCompiled;                // Detect with precompiled .hcc cascades instead of CascadeClassifier
+
+    // OpenCV Verify : useCompiled rects are checked against CascadeClassifier::detectMultiScale on the same image and settings
+    static bool verifyOpenCV;
+    static double verifyOverlap;            // IoU at which a compiled rect matches an OpenCV rect
+    static atomic<long long> referenceRects, compiledRects, matchedRects;
+
 public:
     Cascade(string cascadePath) {
         path = cascadePath;
-        cascade.load(cascadePath);
     }
     
+    CascadeClassifier& classifier();
+    CompiledCascade* compiledClassifier();
     void detectMultiScale(Mat grayscaleImage);
+    void detectInRegions(Mat grayscaleImage, const vector<Rect>& regions, double upperFraction = 1.0);
     void settings(double _scaleFactor, int _minNeighbors, Size _minSize);
     void generateDebugAllCascades(Mat grayscaleImage);
+    void verifyRects(Mat grayscaleImage, const vector<Rect>& found);
+    string identity() const;
+
+    static void detectShared(Mat grayscaleImage, const vector<Cascade*>& cascades, bool debugAll = false);
 
 };
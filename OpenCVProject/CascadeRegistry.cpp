@@ -0,0 +1,135 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <atomic>
+
+#include "CascadeRegistry.h"
+#include "Log.h"
+
+#define endlog Log::printStream()
+
+using namespace std;
+using namespace cv;
+
+// ------------------------------ Static Variables ------------------------------ //
+map<string, shared_ptr<CascadeRegistry::Source>> CascadeRegistry::sourceMap;
+map<string, shared_ptr<CompiledCascade>> CascadeRegistry::compiledMap;
+mutex CascadeRegistry::registryMutex;
+atomic<unsigned> CascadeRegistry::generation = 0;
+
+// Classifiers of the calling thread : Destroyed with the thread, so exited workers leave nothing behind
+struct ThreadCascades {
+	unsigned generation = 0;
+	map<string, shared_ptr<CascadeClassifier>> classifiers;
+};
+static thread_local ThreadCascades threadCascades;
+
+// ------------------------------- Lazy Loading --------------------------------- //
+/// <summary>
+/// Get the classifier for path on the calling thread, loading it on first use.
+/// The file is read and parsed once per process : A cascade that fails to load is still stored (empty) so a bad path is only reported once.
+/// </summary>
+/// <param name="path"> Cascade XML path </param>
+shared_ptr<CascadeClassifier> CascadeRegistry::get(const string& path) {
+	unsigned current = generation;
+	if (threadCascades.generation != current) {
+		threadCascades.classifiers.clear();
+		threadCascades.generation = current;
+	}
+	auto found = threadCascades.classifiers.find(path);
+	if (found != threadCascades.classifiers.end()) {
+		return found->second;
+	}
+
+	// First use on any thread : Parse the file (under the lock, so it happens once)
+	shared_ptr<Source> source;
+	shared_ptr<CascadeClassifier> classifier;
+	{
+		lock_guard<mutex> lock(registryMutex);
+		auto loaded = sourceMap.find(path);
+		if (loaded != sourceMap.end()) {
+			source = loaded->second;
+		}
+		else {
+			source = make_shared<Source>();
+			classifier = make_shared<CascadeClassifier>();
+			try {
+				source->storage.open(path, FileStorage::READ);
+			}
+			catch (const cv::Exception&) {}
+			source->fromNodes = source->storage.isOpened() && classifier->read(source->storage.getFirstTopLevelNode());
+			source->valid = source->fromNodes || classifier->load(path);
+			if (!source->valid) {
+				Log::println("[ERROR] Could not load cascade \"" + path + "\"", LOG_ERROR);
+			}
+			sourceMap.emplace(path, source);
+		}
+	}
+
+	// Later threads : Their own instance from the parsed nodes
+	if (!classifier) classifier = build(path, *source);
+	threadCascades.classifiers.emplace(path, classifier);
+	return classifier;
+}
+
+// Own classifier for one thread : Read from the shared nodes, from disk only for formats read() does not take (old style cascades)
+shared_ptr<CascadeClassifier> CascadeRegistry::build(const string& path, const Source& source) {
+	shared_ptr<CascadeClassifier> classifier = make_shared<CascadeClassifier>();
+	if (!source.valid) return classifier; // Reported by the first load
+
+	if (source.fromNodes) {
+		lock_guard<mutex> lock(registryMutex); // FileStorage makes no promise about concurrent readers
+		classifier->read(source.storage.getFirstTopLevelNode());
+	}
+	else {
+		classifier->load(path);
+	}
+	return classifier;
+}
+
+/// <summary>
+/// Get the shared compiled cascade for path, mapping (or compiling) it on first use.
+/// Returns nullptr if the XML could not be compiled.
+/// </summary>
+/// <param name="path"> Cascade XML path </param>
+shared_ptr<CompiledCascade> CascadeRegistry::getCompiled(const string& path) {
+	lock_guard<mutex> lock(registryMutex);
+
+	auto found = compiledMap.find(path);
+	if (found != compiledMap.end()) {
+		return found->second;
+	}
+
+	shared_ptr<CompiledCascade> compiled = CompiledCascade::load(path);
+	compiledMap.emplace(path, compiled);
+	return compiled;
+}
+
+// Load path now instead of on first detection
+void CascadeRegistry::preload(const string& path) {
+	get(path);
+}
+
+// -------------------------------- Registry Info -------------------------------- //
+bool CascadeRegistry::isLoaded(const string& path) {
+	lock_guard<mutex> lock(registryMutex);
+	return sourceMap.find(path) != sourceMap.end() || compiledMap.find(path) != compiledMap.end();
+}
+
+int CascadeRegistry::loadedCount() {
+	lock_guard<mutex> lock(registryMutex);
+	return (int)(sourceMap.size() + compiledMap.size());
+}
+
+// Drop all classifiers : Cascades still holding one keep it alive until they release it, other threads drop theirs on their next get()
+void CascadeRegistry::clear() {
+	lock_guard<mutex> lock(registryMutex);
+	sourceMap.clear();
+	generation++;
+	compiledMap.clear();
+}
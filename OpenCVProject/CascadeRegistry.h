@@ -0,0 +1,52 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <atomic>
+
+#include "CompiledCascade.h"
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+/// <summary>
+/// Process wide store of loaded CascadeClassifiers.
+/// Each cascade file is read and parsed once, the first time it is requested, and shared by every Cascade using that path.
+/// Settings and result rects stay on the Cascade itself so a shared classifier is never written to by its users.
+/// CascadeClassifier keeps evaluator state while detecting (and a copy shares that state), so get() hands out one instance per path per thread :
+/// Those read the nodes parsed by the first load (no disk read, no second parse) and live in a thread_local cache that is freed when the thread exits.
+/// getCompiled() does the same for the precompiled .hcc form used by Cascade::useCompiled : These are read only and shared by every thread.
+/// </summary>
+class CascadeRegistry {
+private:
+	// One cascade file : Parsed once, every thread's classifier is built from its nodes
+	struct Source {
+		FileStorage storage;	// The parsed file : Only read under registryMutex
+		bool fromNodes = false;	// read() took the parsed nodes : False for old style cascades, which each thread loads from disk
+		bool valid = false;		// The first load succeeded
+	};
+
+	static map<string, shared_ptr<Source>> sourceMap;				// Path, parsed once
+	static map<string, shared_ptr<CompiledCascade>> compiledMap;	// Path, mapped .hcc
+	static mutex registryMutex;
+	static atomic<unsigned> generation;								// Bumped by clear() : Threads drop their classifiers on the next get()
+
+	static shared_ptr<CascadeClassifier> build(const string& path, const Source& source);
+
+public:
+	// Lazy Loading :
+	static shared_ptr<CascadeClassifier> get(const string& path);
+	static shared_ptr<CompiledCascade> getCompiled(const string& path);
+	static void preload(const string& path);
+
+	// Registry Info :
+	static bool isLoaded(const string& path);
+	static int loadedCount();
+	static void clear();
+};
@@ -0,0 +1,742 @@
+#include <iostream>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <memory>
+#include <limits>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "CompiledCascade.h"
+#include "Log.h"
+
+#define endlog Log::printStream()
+
+namespace fs = std::filesystem;
+using namespace std;
+using namespace cv;
+
+static const float THRESHOLD_EPS = 1e-5f;	// Same stage threshold bias as cv::CascadeClassifier
+static const double GROUP_EPS = 0.2;		// Same grouping as cv::CascadeClassifier
+
+CompiledCascade::SimdLevel CompiledCascade::simd = CompiledCascade::detectSimd();
+bool CompiledCascade::verifySimd = false;
+atomic<long long> CompiledCascade::verifiedWindows(0);
+atomic<long long> CompiledCascade::mismatchedWindows(0);
+
+CompiledCascade::~CompiledCascade() {
+	unmapFile();
+}
+
+// ------------------------------- Loading --------------------------------- //
+/// <summary>
+/// Load the compiled form of xmlPath.
+/// Uses the existing .hcc when its checksum and source stamp are valid, otherwise recompiles it from the XML.
+/// If the .hcc can not be written the compiled arrays are kept in memory for this process only.
+/// </summary>
+/// <param name="xmlPath"> OpenCV cascade XML path </param>
+shared_ptr<CompiledCascade> CompiledCascade::load(const string& xmlPath) {
+	shared_ptr<CompiledCascade> cascade = make_shared<CompiledCascade>();
+	cascade->xmlPath = xmlPath;
+	cascade->binaryPath = binaryPathFor(xmlPath);
+
+	// Warm Start : Existing binary is up to date
+	if (cascade->mapFile(cascade->binaryPath) && cascade->validate(xmlPath)) {
+		return cascade;
+	}
+	cascade->unmapFile();
+
+	// Cold Start : (Re)generate binary from XML
+	startlog << "Compiling Cascade : \"" << xmlPath << "\" : " << endlog;
+	if (compile(xmlPath, cascade->binaryPath) && cascade->mapFile(cascade->binaryPath) && cascade->validate(xmlPath)) {
+		startlog << "[-Successful-]" << endl << endlog;
+		return cascade;
+	}
+	cascade->unmapFile();
+
+	// Binary could not be written : Keep compiled arrays in memory
+	if (compileToBuffer(xmlPath, cascade->ownedData) && cascade->attach(cascade->ownedData.data(), cascade->ownedData.size())) {
+		startlog << "[-Successful-] (In Memory)" << endl << endlog;
+		return cascade;
+	}
+
+	startlog << "[-Failed-]" << endl << endlog;
+	Log::println("[ERROR] Could not compile cascade \"" + xmlPath + "\"", LOG_ERROR);
+	return nullptr;
+}
+
+// Compile XML into .hcc file
+bool CompiledCascade::compile(const string& xmlPath, const string& binaryPath) {
+	vector<char> buffer;
+	if (!compileToBuffer(xmlPath, buffer)) return false;
+
+	// Write to temp file then rename so a half written binary is never mapped
+	string tempPath = binaryPath + ".tmp";
+	{
+		ofstream file(tempPath, ios::binary | ios::trunc);
+		if (!file) return false;
+		file.write(buffer.data(), buffer.size());
+		if (!file) return false;
+	}
+	error_code ec;
+	fs::rename(tempPath, binaryPath, ec);
+	if (ec) {
+		fs::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+// "name.xml" -> "name.hcc"
+string CompiledCascade::binaryPathFor(const string& xmlPath) {
+	return fs::path(xmlPath).replace_extension(".hcc").string();
+}
+
+bool CompiledCascade::compileToBuffer(const string& xmlPath, vector<char>& buffer) {
+
+	FileStorage storage(xmlPath, FileStorage::READ);
+	if (!storage.isOpened()) return false;
+
+	FileNode root = storage.getFirstTopLevelNode();
+	if ((string)root["stageType"] != "BOOST") return false; // Old style cascades are not supported
+
+	CompiledCascadeHeader header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	if (!sourceStamp(xmlPath, header.sourceSize, header.sourceTime)) return false;
+
+	string featureType = (string)root["featureType"];
+	if (featureType == "HAAR") {
+		header.featureType = HAAR;
+	}
+	else if (featureType == "LBP") {
+		header.featureType = LBP;
+	}
+	else {
+		return false;
+	}
+	header.windowWidth = (int)root["width"];
+	header.windowHeight = (int)root["height"];
+
+	int maxCatCount = (int)root["featureParams"]["maxCatCount"];
+	header.subsetSize = (maxCatCount > 0) ? (maxCatCount + 31) / 32 : 0;
+	int nodeStep = (header.subsetSize > 0) ? 3 + header.subsetSize : 4;
+
+	vector<CompiledStage> stages;
+	vector<CompiledClassifier> classifiers;
+	vector<CompiledNode> nodes;
+	vector<float> leaves;
+	vector<int32_t> subsets;
+
+	// Stages :
+	for (FileNode stageNode : root["stages"]) {
+		CompiledStage stage;
+		stage.first = (int32_t)classifiers.size();
+		stage.threshold = (float)stageNode["stageThreshold"] - THRESHOLD_EPS;
+
+		for (FileNode weakNode : stageNode["weakClassifiers"]) {
+			FileNode internalNodes = weakNode["internalNodes"];
+			FileNode leafValues = weakNode["leafValues"];
+
+			CompiledClassifier classifier;
+			classifier.nodeOffset = (int32_t)nodes.size();
+			classifier.nodeCount = (int32_t)(internalNodes.size() / nodeStep);
+			classifier.leafOffset = (int32_t)leaves.size();
+			if (classifier.nodeCount <= 0 || (int)leafValues.size() != classifier.nodeCount + 1) return false;
+
+			FileNodeIterator value = internalNodes.begin();
+			for (int i = 0; i < classifier.nodeCount; i++) {
+				CompiledNode node;
+				node.left = (int)*value; ++value;
+				node.right = (int)*value; ++value;
+				node.featureIdx = (int)*value; ++value;
+				if (header.subsetSize > 0) {
+					node.threshold = 0;
+					for (int j = 0; j < header.subsetSize; j++, ++value) {
+						subsets.push_back((int)*value);
+					}
+				}
+				else {
+					node.threshold = (float)*value; ++value;
+				}
+				nodes.push_back(node);
+			}
+			for (FileNode leaf : leafValues) {
+				leaves.push_back((float)leaf);
+			}
+			classifiers.push_back(classifier);
+		}
+		stage.count = (int32_t)classifiers.size() - stage.first;
+		stages.push_back(stage);
+	}
+
+	// Features :
+	vector<CompiledHaarFeature> haarFeatures;
+	vector<CompiledLBPFeature> lbpFeatures;
+	for (FileNode featureNode : root["features"]) {
+		if (header.featureType == HAAR) {
+			CompiledHaarFeature feature = {};
+			feature.tilted = ((int)featureNode["tilted"] != 0) ? 1 : 0;
+			int r = 0;
+			for (FileNode rectNode : featureNode["rects"]) {
+				if (r >= 3) return false;
+				FileNodeIterator value = rectNode.begin();
+				for (int i = 0; i < 4; i++, ++value) {
+					feature.rects[r][i] = (int)*value;
+				}
+				feature.weights[r] = (float)*value;
+				r++;
+			}
+			haarFeatures.push_back(feature);
+		}
+		else {
+			CompiledLBPFeature feature;
+			FileNodeIterator value = featureNode["rect"].begin();
+			feature.x = (int)*value; ++value;
+			feature.y = (int)*value; ++value;
+			feature.width = (int)*value; ++value;
+			feature.height = (int)*value;
+			lbpFeatures.push_back(feature);
+		}
+	}
+
+	header.stageCount = (int32_t)stages.size();
+	header.classifierCount = (int32_t)classifiers.size();
+	header.nodeCount = (int32_t)nodes.size();
+	header.leafCount = (int32_t)leaves.size();
+	header.featureCount = (int32_t)((header.featureType == HAAR) ? haarFeatures.size() : lbpFeatures.size());
+
+	// Flatten :
+	buffer.clear();
+	auto append = [&buffer](const void* bytes, size_t size) {
+		const char* begin = (const char*)bytes;
+		buffer.insert(buffer.end(), begin, begin + size);
+	};
+	append(&header, sizeof(header));
+	append(stages.data(), stages.size() * sizeof(CompiledStage));
+	append(classifiers.data(), classifiers.size() * sizeof(CompiledClassifier));
+	append(nodes.data(), nodes.size() * sizeof(CompiledNode));
+	append(leaves.data(), leaves.size() * sizeof(float));
+	append(haarFeatures.data(), haarFeatures.size() * sizeof(CompiledHaarFeature));
+	append(lbpFeatures.data(), lbpFeatures.size() * sizeof(CompiledLBPFeature));
+	append(subsets.data(), subsets.size() * sizeof(int32_t));
+
+	// Checksum payload :
+	CompiledCascadeHeader* written = (CompiledCascadeHeader*)buffer.data();
+	written->checksum = checksum(buffer.data() + sizeof(CompiledCascadeHeader), buffer.size() - sizeof(CompiledCascadeHeader));
+	return true;
+}
+
+// XML size and last write time : Changes to either regenerate the binary
+bool CompiledCascade::sourceStamp(const string& xmlPath, uint64_t& size, int64_t& time) {
+	error_code ec;
+	size = (uint64_t)fs::file_size(xmlPath, ec);
+	if (ec) return false;
+	time = (int64_t)fs::last_write_time(xmlPath, ec).time_since_epoch().count();
+	return !ec;
+}
+
+// FNV-1a 64
+uint64_t CompiledCascade::checksum(const char* bytes, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (unsigned char)bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// ------------------------------- Mapping --------------------------------- //
+bool CompiledCascade::mapFile(const string& path) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		return false;
+	}
+	const char* view = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = view;
+	dataSize = (size_t)size.QuadPart;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) return false;
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0) {
+		close(file);
+		return false;
+	}
+	void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (view == MAP_FAILED) return false;
+	data = (const char*)view;
+	dataSize = (size_t)info.st_size;
+#endif
+	return attach(data, dataSize);
+}
+
+void CompiledCascade::unmapFile() {
+	if (data && ownedData.empty()) {
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+		if (fileHandle) CloseHandle((HANDLE)fileHandle);
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+#else
+		munmap((void*)data, dataSize);
+#endif
+	}
+	data = nullptr;
+	dataSize = 0;
+	header = nullptr;
+}
+
+// Point the array views into bytes : Fails if the sizes in the header do not add up
+bool CompiledCascade::attach(const char* bytes, size_t size) {
+	data = bytes;
+	dataSize = size;
+	if (size < sizeof(CompiledCascadeHeader)) return false;
+
+	const CompiledCascadeHeader* h = (const CompiledCascadeHeader*)bytes;
+	if (h->magic != MAGIC || h->version != VERSION) return false;
+	if (h->stageCount < 0 || h->classifierCount < 0 || h->nodeCount < 0 || h->leafCount < 0 || h->featureCount < 0 || h->subsetSize < 0) return false;
+
+	size_t featureSize = (h->featureType == HAAR) ? sizeof(CompiledHaarFeature) : sizeof(CompiledLBPFeature);
+	size_t expected = sizeof(CompiledCascadeHeader)
+		+ (size_t)h->stageCount * sizeof(CompiledStage)
+		+ (size_t)h->classifierCount * sizeof(CompiledClassifier)
+		+ (size_t)h->nodeCount * sizeof(CompiledNode)
+		+ (size_t)h->leafCount * sizeof(float)
+		+ (size_t)h->featureCount * featureSize
+		+ (size_t)h->nodeCount * h->subsetSize * sizeof(int32_t);
+	if (expected != size) return false;
+
+	const char* cursor = bytes + sizeof(CompiledCascadeHeader);
+	header = h;
+	stages = (const CompiledStage*)cursor;				cursor += h->stageCount * sizeof(CompiledStage);
+	classifiers = (const CompiledClassifier*)cursor;	cursor += h->classifierCount * sizeof(CompiledClassifier);
+	nodes = (const CompiledNode*)cursor;				cursor += h->nodeCount * sizeof(CompiledNode);
+	leaves = (const float*)cursor;						cursor += h->leafCount * sizeof(float);
+	haarFeatures = (h->featureType == HAAR) ? (const CompiledHaarFeature*)cursor : nullptr;
+	lbpFeatures = (h->featureType == LBP) ? (const CompiledLBPFeature*)cursor : nullptr;
+	cursor += h->featureCount * featureSize;
+	subsets = (const int32_t*)cursor;
+
+	tiltedFeatures = false;
+	for (int f = 0; haarFeatures && f < h->featureCount; f++) {
+		if (haarFeatures[f].tilted) tiltedFeatures = true;
+	}
+	buildStumpLayout();
+	return true;
+}
+
+/// <summary>
+/// Copy a stump-only HAAR cascade into StumpLayout : Each field is one contiguous array in evaluation order,
+/// so the SIMD evaluator streams through them instead of hopping between stages, classifiers, nodes and features.
+/// Trees (and LBP) keep the layout empty and use the scalar evaluator.
+/// </summary>
+void CompiledCascade::buildStumpLayout() {
+	stumps = StumpLayout();
+	if (header->featureType != HAAR) return;
+	for (int c = 0; c < header->classifierCount; c++) {
+		if (classifiers[c].nodeCount != 1) return;
+	}
+
+	for (int s = 0; s < header->stageCount; s++) {
+		const CompiledStage& stage = stages[s];
+		for (int c = stage.first; c < stage.first + stage.count; c++) {
+			const CompiledClassifier& classifier = classifiers[c];
+			const CompiledNode& node = nodes[classifier.nodeOffset];
+			const CompiledHaarFeature& feature = haarFeatures[node.featureIdx];
+			stumps.feature.push_back(node.featureIdx);
+			stumps.tilted.push_back(feature.tilted ? 1 : 0);
+			stumps.weight0.push_back(feature.weights[0]);
+			stumps.weight1.push_back(feature.weights[1]);
+			stumps.weight2.push_back(feature.weights[2]);
+			stumps.threshold.push_back(node.threshold);
+			stumps.left.push_back(leaves[classifier.leafOffset - node.left]);
+			stumps.right.push_back(leaves[classifier.leafOffset - node.right]);
+		}
+		stumps.stageEnd.push_back((int32_t)stumps.feature.size());
+		stumps.stageThreshold.push_back(stage.threshold);
+	}
+}
+
+// Binary matches current XML and payload is intact
+bool CompiledCascade::validate(const string& xmlPath) const {
+	if (!header) return false;
+
+	uint64_t size;
+	int64_t time;
+	if (!sourceStamp(xmlPath, size, time)) return false;
+	if (size != header->sourceSize || time != header->sourceTime) return false;
+
+	return checksum(data + sizeof(CompiledCascadeHeader), dataSize - sizeof(CompiledCascadeHeader)) == header->checksum;
+}
+
+// ------------------------------- Detection --------------------------------- //
+Size CompiledCascade::windowSize() const {
+	if (!header) return Size(0, 0);
+	return Size(header->windowWidth, header->windowHeight);
+}
+
+bool CompiledCascade::needsSquares() const {
+	return header && header->featureType == HAAR;
+}
+
+bool CompiledCascade::needsTilted() const {
+	return tiltedFeatures;
+}
+
+/// <summary>
+/// Same scale walk, window step and grouping as cv::CascadeClassifier::detectMultiScale.
+/// </summary>
+void CompiledCascade::detectMultiScale(const Mat& grayscaleImage, vector<Rect>& rects, double scaleFactor, int minNeighbors, Size minSize) const {
+	rects.clear();
+	if (!header || grayscaleImage.empty()) return;
+
+	PyramidLevel level;
+	for (double factor : scaleFactors(grayscaleImage.size(), scaleFactor, minSize)) {
+		buildLevel(grayscaleImage, factor, needsSquares(), needsTilted(), level);
+		detectAtScale(level, rects);
+	}
+	groupRectangles(rects, minNeighbors, GROUP_EPS);
+}
+
+/// <summary>
+/// Factors cv::CascadeClassifier would scan imageSize at : Stops once the window no longer fits, skips windows under minSize.
+/// Cascades with the same window size and scaleFactor get identical factors, so their levels can be shared.
+/// </summary>
+vector<double> CompiledCascade::scaleFactors(Size imageSize, double scaleFactor, Size minSize) const {
+	vector<double> factors;
+	if (!header || scaleFactor <= 1) return factors;
+
+	const Size window = windowSize();
+	for (double factor = 1; ; factor *= scaleFactor) {
+		Size scaledWindow(cvRound(window.width * factor), cvRound(window.height * factor));
+		Size scaledSize(cvRound(imageSize.width / factor), cvRound(imageSize.height / factor));
+
+		if (scaledSize.width - window.width <= 0 || scaledSize.height - window.height <= 0) break;
+		if (scaledWindow.width > imageSize.width || scaledWindow.height > imageSize.height) break;
+		if (scaledWindow.width < minSize.width || scaledWindow.height < minSize.height) continue;
+		factors.push_back(factor);
+	}
+	return factors;
+}
+
+// Resize grayscaleImage by 1 / factor and build the integrals the cascades need
+void CompiledCascade::buildLevel(const Mat& grayscaleImage, double factor, bool squares, bool tilted, PyramidLevel& level) {
+	level.factor = factor;
+	resize(grayscaleImage, level.image, Size(cvRound(grayscaleImage.cols / factor), cvRound(grayscaleImage.rows / factor)), 0, 0, INTER_LINEAR);
+	if (tilted) {
+		cv::integral(level.image, level.sum, level.sqsum, level.tilted, CV_32S, CV_64F);
+	}
+	else if (squares) {
+		cv::integral(level.image, level.sum, level.sqsum, CV_32S, CV_64F);
+		level.tilted.release();
+	}
+	else {
+		cv::integral(level.image, level.sum, CV_32S);
+		level.sqsum.release();
+		level.tilted.release();
+	}
+}
+
+// Rect sum from four integral offsets
+static inline int rectSum(const int* p, const int* ofs) {
+	return p[ofs[0]] - p[ofs[1]] - p[ofs[2]] + p[ofs[3]];
+}
+
+// Variance normalization rect (1, 1, w - 2, h - 2) of a window at one integral step
+struct WindowNorm {
+	int sumOfs[4];
+	int sqOfs[4];
+	double area;
+
+	WindowNorm(Size window, int step, int sqStep) : area((double)(window.width - 2) * (window.height - 2)) {
+		int corners[4][2] = { { 1, 1 }, { window.width - 1, 1 }, { 1, window.height - 1 }, { window.width - 1, window.height - 1 } };
+		for (int i = 0; i < 4; i++) {
+			sumOfs[i] = corners[i][0] + step * corners[i][1];
+			sqOfs[i] = corners[i][0] + sqStep * corners[i][1];
+		}
+	}
+
+	// HAAR variance normalization of the window at x : False for windows rejected outright (flat)
+	bool operator()(const int* sumRow, const double* sqRow, int x, float& varianceNormFactor) const {
+		const int* p = sumRow + x;
+		const double* pq = sqRow + x;
+		int valsum = rectSum(p, sumOfs);
+		double valsqsum = pq[sqOfs[0]] - pq[sqOfs[1]] - pq[sqOfs[2]] + pq[sqOfs[3]];
+		double nf = area * valsqsum - (double)valsum * valsum;
+		if (nf <= 0.) return false;
+		varianceNormFactor = (float)(1. / sqrt(nf));
+		return area * varianceNormFactor < 1e-1;
+	}
+};
+
+// Feature rect offsets for one integral step : 12 per HAAR feature (3 rects), 16 per LBP feature (4x4 grid)
+void CompiledCascade::buildFeatureOffsets(int step, vector<int>& featureOffsets) const {
+	if (header->featureType == HAAR) {
+		featureOffsets.resize(header->featureCount * 12);
+		for (int f = 0; f < header->featureCount; f++) {
+			const CompiledHaarFeature& feature = haarFeatures[f];
+			for (int r = 0; r < 3; r++) {
+				int* ofs = &featureOffsets[f * 12 + r * 4];
+				const int* rc = feature.rects[r];
+				if (feature.weights[r] == 0) {
+					ofs[0] = ofs[1] = ofs[2] = ofs[3] = 0;
+				}
+				else if (feature.tilted) {
+					ofs[0] = rc[0] + step * rc[1];
+					ofs[1] = rc[0] - rc[3] + step * (rc[1] + rc[3]);
+					ofs[2] = rc[0] + rc[2] + step * (rc[1] + rc[2]);
+					ofs[3] = rc[0] + rc[2] - rc[3] + step * (rc[1] + rc[2] + rc[3]);
+				}
+				else {
+					ofs[0] = rc[0] + step * rc[1];
+					ofs[1] = rc[0] + rc[2] + step * rc[1];
+					ofs[2] = rc[0] + step * (rc[1] + rc[3]);
+					ofs[3] = rc[0] + rc[2] + step * (rc[1] + rc[3]);
+				}
+			}
+		}
+	}
+	else {
+		featureOffsets.resize(header->featureCount * 16);
+		for (int f = 0; f < header->featureCount; f++) {
+			const CompiledLBPFeature& feature = lbpFeatures[f];
+			for (int j = 0; j < 4; j++) {
+				for (int i = 0; i < 4; i++) {
+					featureOffsets[f * 16 + j * 4 + i] = (feature.x + i * feature.width) + step * (feature.y + j * feature.height);
+				}
+			}
+		}
+	}
+
+}
+
+// Stump feature offsets gathered in stump order for the SIMD evaluators
+void CompiledCascade::buildStumpOffsets(const vector<int>& featureOffsets, vector<int>& stumpOffsets) const {
+	stumpOffsets.resize(stumps.size() * 12);
+	for (size_t i = 0; i < stumps.size(); i++) {
+		memcpy(&stumpOffsets[i * 12], &featureOffsets[stumps.feature[i] * 12], 12 * sizeof(int));
+	}
+}
+
+/// <summary>
+/// Evaluate every window of one pyramid level, appending hits (in image space) to candidates.
+/// </summary>
+void CompiledCascade::detectAtScale(const PyramidLevel& level, vector<Rect>& candidates) const {
+	if (!header || level.sum.empty()) return;
+
+	const bool isHaar = header->featureType == HAAR;
+	if (isHaar && (level.sqsum.empty() || (tiltedFeatures && level.tilted.empty()))) return; // Level built without what this cascade needs
+
+	const double factor = level.factor;
+	const Size window = windowSize();
+	const Size scaledWindow(cvRound(window.width * factor), cvRound(window.height * factor));
+	const int step = (int)(level.sum.step / sizeof(int));
+	const int sqStep = isHaar ? (int)(level.sqsum.step / sizeof(double)) : 0;
+	const int windowStep = (factor > 2.) ? 1 : 2;
+	const int xEnd = level.image.cols - window.width;
+	const int yEnd = level.image.rows - window.height;
+
+	vector<int> featureOffsets;
+	buildFeatureOffsets(step, featureOffsets);
+	const WindowNorm windowNorm(window, step, sqStep);
+
+	// SIMD : Neighboring windows of a row evaluated together (stump cascades only)
+	const int lanes = (isHaar && stumps.size() > 0) ? ((simd == SIMD_AVX2) ? 8 : (simd == SIMD_SSE41) ? 4 : 0) : 0;
+	vector<int> stumpOffsets;
+	if (lanes > 0) buildStumpOffsets(featureOffsets, stumpOffsets);
+
+	for (int y = 0; y <= yEnd; y += windowStep) {
+		const int* sumRow = level.sum.ptr<int>(y);
+		const int* tiltedRow = tiltedFeatures ? level.tilted.ptr<int>(y) : nullptr;
+		const double* sqRow = isHaar ? level.sqsum.ptr<double>(y) : nullptr;
+		int x = 0;
+
+		for (; lanes > 0 && x <= xEnd; x += lanes * windowStep) {
+			int32_t xs[8];
+			float varianceNormFactors[8];
+			int activeMask = 0;
+			for (int l = 0; l < lanes; l++) {
+				xs[l] = x + l * windowStep;
+				varianceNormFactors[l] = 1.f;
+				if (xs[l] > xEnd) {
+					xs[l] = x; // Past the row : Inactive, but keep its loads in bounds
+				}
+				else if (windowNorm(sumRow, sqRow, xs[l], varianceNormFactors[l])) {
+					activeMask |= 1 << l;
+				}
+			}
+			if (!activeMask) continue;
+
+			int passedMask = (simd == SIMD_AVX2)
+				? evaluateStumpsAVX2(stumpOffsets.data(), sumRow, tiltedRow, xs, varianceNormFactors, activeMask)
+				: evaluateStumpsSSE41(stumpOffsets.data(), sumRow, tiltedRow, xs, varianceNormFactors, activeMask);
+
+			if (verifySimd) {
+				for (int l = 0; l < lanes; l++) {
+					if (!(activeMask & (1 << l))) continue;
+					bool scalar = evaluateWindow(sumRow + xs[l], tiltedRow ? tiltedRow + xs[l] : nullptr, varianceNormFactors[l], featureOffsets.data());
+					verifiedWindows++;
+					if (scalar != ((passedMask >> l) & 1)) mismatchedWindows++;
+				}
+			}
+
+			for (int l = 0; l < lanes; l++) {
+				if (passedMask & (1 << l)) {
+					candidates.push_back(Rect(cvRound(xs[l] * factor), cvRound(y * factor), scaledWindow.width, scaledWindow.height));
+				}
+			}
+		}
+
+		for (; x <= xEnd; x += windowStep) {
+			float varianceNormFactor = 1.f;
+			if (isHaar && !windowNorm(sumRow, sqRow, x, varianceNormFactor)) continue;
+
+			if (evaluateWindow(sumRow + x, tiltedRow ? tiltedRow + x : nullptr, varianceNormFactor, featureOffsets.data())) {
+				candidates.push_back(Rect(cvRound(x * factor), cvRound(y * factor), scaledWindow.width, scaledWindow.height));
+			}
+		}
+	}
+}
+
+// Scalar evaluation of every stage for the window at p (pt : Same window in the tilted integral)
+bool CompiledCascade::evaluateWindow(const int* p, const int* pt, float varianceNormFactor, const int* featureOffsets, double* stageSums) const {
+	const bool isHaar = header->featureType == HAAR;
+
+	for (int s = 0; s < header->stageCount; s++) {
+		const CompiledStage& stage = stages[s];
+		double stageSum = 0;
+		for (int c = stage.first; c < stage.first + stage.count; c++) {
+			const CompiledClassifier& classifier = classifiers[c];
+			int idx = 0;
+			do {
+				int nodeIdx = classifier.nodeOffset + idx;
+				const CompiledNode& node = nodes[nodeIdx];
+				if (isHaar) {
+					const int* ofs = &featureOffsets[node.featureIdx * 12];
+					const CompiledHaarFeature& feature = haarFeatures[node.featureIdx];
+					const int* src = feature.tilted ? pt : p;
+					float value = feature.weights[0] * rectSum(src, ofs) + feature.weights[1] * rectSum(src, ofs + 4);
+					if (feature.weights[2] != 0) value += feature.weights[2] * rectSum(src, ofs + 8);
+					idx = (value * varianceNormFactor < node.threshold) ? node.left : node.right;
+				}
+				else {
+					const int* ofs = &featureOffsets[node.featureIdx * 16];
+					int center = p[ofs[5]] - p[ofs[6]] - p[ofs[9]] + p[ofs[10]];
+					int code =
+						(p[ofs[0]] - p[ofs[1]] - p[ofs[4]] + p[ofs[5]] >= center ? 128 : 0) |
+						(p[ofs[1]] - p[ofs[2]] - p[ofs[5]] + p[ofs[6]] >= center ? 64 : 0) |
+						(p[ofs[2]] - p[ofs[3]] - p[ofs[6]] + p[ofs[7]] >= center ? 32 : 0) |
+						(p[ofs[6]] - p[ofs[7]] - p[ofs[10]] + p[ofs[11]] >= center ? 16 : 0) |
+						(p[ofs[10]] - p[ofs[11]] - p[ofs[14]] + p[ofs[15]] >= center ? 8 : 0) |
+						(p[ofs[9]] - p[ofs[10]] - p[ofs[13]] + p[ofs[14]] >= center ? 4 : 0) |
+						(p[ofs[8]] - p[ofs[9]] - p[ofs[12]] + p[ofs[13]] >= center ? 2 : 0) |
+						(p[ofs[4]] - p[ofs[5]] - p[ofs[8]] + p[ofs[9]] >= center ? 1 : 0);
+					const int32_t* subset = &subsets[nodeIdx * header->subsetSize];
+					idx = (subset[code >> 5] & (1 << (code & 31))) ? node.left : node.right;
+				}
+			} while (idx > 0);
+			stageSum += leaves[classifier.leafOffset - idx];
+		}
+		if (stageSums) stageSums[s] = stageSum;
+		if (stageSum < stage.threshold) return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Stage sums of the windows at xs in row y of level, [stage][window], through the scalar evaluator or one SIMD evaluator.
+/// SIMD paths take exactly 4 (SSE4.1) or 8 (AVX2) windows, stump cascades only. Stages after a window is rejected stay NaN, as do flat windows.
+/// Empty when the path can't run this cascade here.
+/// </summary>
+vector<double> CompiledCascade::stageSums(const PyramidLevel& level, int y, const vector<int32_t>& xs, SimdLevel path) const {
+	vector<double> sums;
+	if (!header || header->featureType != HAAR || level.sum.empty() || level.sqsum.empty() || (tiltedFeatures && level.tilted.empty())) return sums;
+
+	const int lanes = (path == SIMD_AVX2) ? 8 : (path == SIMD_SSE41) ? 4 : (int)xs.size();
+	if ((int)xs.size() != lanes || path > detectSimd() || (path != SIMD_NONE && stumps.size() == 0)) return sums;
+	if (y < 0 || y > level.image.rows - windowSize().height) return sums;
+	for (int32_t x : xs) if (x < 0 || x > level.image.cols - windowSize().width) return sums;
+
+	const int step = (int)(level.sum.step / sizeof(int));
+	vector<int> featureOffsets;
+	buildFeatureOffsets(step, featureOffsets);
+	const WindowNorm windowNorm(windowSize(), step, (int)(level.sqsum.step / sizeof(double)));
+
+	const int* sumRow = level.sum.ptr<int>(y);
+	const int* tiltedRow = tiltedFeatures ? level.tilted.ptr<int>(y) : nullptr;
+	const double* sqRow = level.sqsum.ptr<double>(y);
+
+	sums.assign((size_t)header->stageCount * lanes, std::numeric_limits<double>::quiet_NaN());
+	if (path == SIMD_NONE) {
+		vector<double> windowSums(header->stageCount, std::numeric_limits<double>::quiet_NaN());
+		for (int l = 0; l < lanes; l++) {
+			float varianceNormFactor = 1.f;
+			if (!windowNorm(sumRow, sqRow, xs[l], varianceNormFactor)) continue;
+			std::fill(windowSums.begin(), windowSums.end(), std::numeric_limits<double>::quiet_NaN());
+			evaluateWindow(sumRow + xs[l], tiltedRow ? tiltedRow + xs[l] : nullptr, varianceNormFactor, featureOffsets.data(), windowSums.data());
+			for (int s = 0; s < header->stageCount; s++) sums[(size_t)s * lanes + l] = windowSums[s];
+		}
+		return sums;
+	}
+
+	float varianceNormFactors[8];
+	int activeMask = 0;
+	for (int l = 0; l < lanes; l++) {
+		varianceNormFactors[l] = 1.f;
+		if (windowNorm(sumRow, sqRow, xs[l], varianceNormFactors[l])) activeMask |= 1 << l;
+	}
+	if (!activeMask) return sums;
+
+	vector<int> stumpOffsets;
+	buildStumpOffsets(featureOffsets, stumpOffsets);
+	if (path == SIMD_AVX2) evaluateStumpsAVX2(stumpOffsets.data(), sumRow, tiltedRow, xs.data(), varianceNormFactors, activeMask, sums.data());
+	else evaluateStumpsSSE41(stumpOffsets.data(), sumRow, tiltedRow, xs.data(), varianceNormFactors, activeMask, sums.data());
+
+	// Lanes already rejected keep riding along in the vectors : Clear what they summed after their rejecting stage
+	for (int l = 0; l < lanes; l++) {
+		bool rejected = !(activeMask & (1 << l));
+		for (int s = 0; s < header->stageCount; s++) {
+			double& sum = sums[(size_t)s * lanes + l];
+			if (rejected) sum = std::numeric_limits<double>::quiet_NaN();
+			else if (sum < stages[s].threshold) rejected = true;
+		}
+	}
+	return sums;
+}
+
+// Same grouping cv::CascadeClassifier applies to its raw hits
+void CompiledCascade::groupCandidates(vector<Rect>& rects, int minNeighbors) {
+	groupRectangles(rects, minNeighbors, GROUP_EPS);
+}
@@ -0,0 +1,174 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+// ---------------------------- Binary Layout (.hcc) ---------------------------- //
+// [Header][Stages][Classifiers][Nodes][Leaves][Features][Subsets]
+// Every array is a flat run of 4 byte fields so the file can be used straight from memory.
+
+struct CompiledCascadeHeader {
+    uint32_t magic;             // 'HCC1'
+    uint32_t version;
+    uint64_t sourceSize;        // XML size when compiled
+    int64_t sourceTime;         // XML last write time when compiled
+    uint64_t checksum;          // FNV-1a of everything after the header
+    int32_t featureType;        // CompiledCascade::HAAR / CompiledCascade::LBP
+    int32_t windowWidth;
+    int32_t windowHeight;
+    int32_t stageCount;
+    int32_t classifierCount;
+    int32_t nodeCount;
+    int32_t leafCount;
+    int32_t featureCount;
+    int32_t subsetSize;         // Ints per LBP node subset (0 for HAAR)
+    int32_t reserved;
+};
+
+struct CompiledStage {
+    int32_t first;              // First classifier index
+    int32_t count;              // Number of classifiers
+    float threshold;
+};
+
+struct CompiledClassifier {
+    int32_t nodeOffset;
+    int32_t nodeCount;
+    int32_t leafOffset;         // nodeCount + 1 leaves
+};
+
+struct CompiledNode {
+    int32_t left;               // > 0 : Next node, <= 0 : -Leaf index
+    int32_t right;
+    int32_t featureIdx;
+    float threshold;            // Unused for LBP (see subsets)
+};
+
+struct CompiledHaarFeature {
+    int32_t tilted;
+    int32_t rects[3][4];        // x, y, width, height
+    float weights[3];           // 0 when the rect is unused
+};
+
+struct CompiledLBPFeature {
+    int32_t x, y, width, height; // One block of the 3x3 LBP grid
+};
+
+// One scale of the image pyramid : Shared by every cascade scanning this factor
+struct PyramidLevel {
+    double factor = 1;
+    Mat image;                  // Grayscale resized by 1 / factor
+    Mat sum;                    // CV_32S integral
+    Mat sqsum;                  // CV_64F squared integral (HAAR)
+    Mat tilted;                 // CV_32S 45 degree integral (HAAR with tilted features)
+};
+
+// Stump (depth 1) HAAR cascade in evaluation order, one array per field : Built on load for the SIMD evaluator
+struct StumpLayout {
+    vector<int32_t> stageEnd;           // One past each stage's last stump
+    vector<float> stageThreshold;
+    vector<int32_t> feature;            // Per stump :
+    vector<uint8_t> tilted;
+    vector<float> weight0, weight1, weight2;
+    vector<float> threshold;
+    vector<float> left, right;          // Leaf values
+
+    size_t size() const { return feature.size(); }
+};
+
+/// <summary>
+/// Haar/LBP cascade compiled from an OpenCV cascade XML into flat arrays.
+/// load() memory maps "name.hcc" next to the XML, validating its checksum and regenerating it when the XML has changed.
+/// detectMultiScale() evaluates the arrays directly so no XML is parsed at all on a warm start.
+/// </summary>
+class CompiledCascade {
+public:
+    static const uint32_t MAGIC = 0x31434348;  // "HCC1"
+    static const uint32_t VERSION = 1;
+    enum FeatureType { HAAR = 0, LBP = 1 };
+    enum SimdLevel { SIMD_NONE, SIMD_SSE41, SIMD_AVX2 };
+
+    // SIMD Settings :
+    static SimdLevel simd;                      // Stump HAAR cascades evaluate 4 (SSE4.1) or 8 (AVX2) windows at once
+    static bool verifySimd;                     // Also run the scalar path on every SIMD window and count disagreements
+    static atomic<long long> verifiedWindows;
+    static atomic<long long> mismatchedWindows;
+
+    // Views into the mapped file :
+    const CompiledCascadeHeader* header = nullptr;
+    const CompiledStage* stages = nullptr;
+    const CompiledClassifier* classifiers = nullptr;
+    const CompiledNode* nodes = nullptr;
+    const float* leaves = nullptr;
+    const CompiledHaarFeature* haarFeatures = nullptr;
+    const CompiledLBPFeature* lbpFeatures = nullptr;
+    const int32_t* subsets = nullptr;
+
+    string xmlPath, binaryPath;
+
+public:
+    CompiledCascade() = default;
+    ~CompiledCascade();
+    CompiledCascade(const CompiledCascade&) = delete;
+    CompiledCascade& operator=(const CompiledCascade&) = delete;
+
+    // Loading :
+    static shared_ptr<CompiledCascade> load(const string& xmlPath);
+    static bool compile(const string& xmlPath, const string& binaryPath);
+    static string binaryPathFor(const string& xmlPath);
+
+    // Detection :
+    Size windowSize() const;
+    bool needsSquares() const;
+    bool needsTilted() const;
+    void detectMultiScale(const Mat& grayscaleImage, vector<Rect>& rects, double scaleFactor, int minNeighbors, Size minSize = Size()) const;
+
+    // Pyramid Steps (see DetectionEngine) :
+    vector<double> scaleFactors(Size imageSize, double scaleFactor, Size minSize) const;
+    void detectAtScale(const PyramidLevel& level, vector<Rect>& candidates) const;
+    static void buildLevel(const Mat& grayscaleImage, double factor, bool squares, bool tilted, PyramidLevel& level);
+    static void groupCandidates(vector<Rect>& rects, int minNeighbors);
+
+    static SimdLevel detectSimd();
+
+    // Evaluator Check (tests) : Stage sums of the windows at xs in row y of level through one evaluator
+    vector<double> stageSums(const PyramidLevel& level, int y, const vector<int32_t>& xs, SimdLevel path) const;
+
+private:
+    // Backing memory : Either a mapped file or an owned buffer when the .hcc could not be written
+    const char* data = nullptr;
+    size_t dataSize = 0;
+    vector<char> ownedData;
+    bool tiltedFeatures = false;    // Any HAAR feature needs the tilted integral
+    StumpLayout stumps;             // Empty unless every HAAR classifier is a stump
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    static bool compileToBuffer(const string& xmlPath, vector<char>& buffer);
+    static bool sourceStamp(const string& xmlPath, uint64_t& size, int64_t& time);
+    static uint64_t checksum(const char* bytes, size_t size);
+
+    bool mapFile(const string& path);
+    void unmapFile();
+    bool attach(const char* bytes, size_t size);
+    bool validate(const string& xmlPath) const;
+    void buildStumpLayout();
+
+    void buildFeatureOffsets(int step, vector<int>& featureOffsets) const;
+    void buildStumpOffsets(const vector<int>& featureOffsets, vector<int>& stumpOffsets) const;
+
+    // stageSums : Optional [stage][lane] output of every stage evaluated (the stage sum of that stage, before its threshold)
+    bool evaluateWindow(const int* p, const int* pt, float varianceNormFactor, const int* featureOffsets, double* stageSums = nullptr) const;
+    int evaluateStumpsSSE41(const int* stumpOffsets, const int* sumRow, const int* tiltedRow, const int32_t* xs, const float* varianceNormFactors, int activeMask, double* stageSums = nullptr) const;
+    int evaluateStumpsAVX2(const int* stumpOffsets, const int* sumRow, const int* tiltedRow, const int32_t* xs, const float* varianceNormFactors, int activeMask, double* stageSums = nullptr) const;
+};
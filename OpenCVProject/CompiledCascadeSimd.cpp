@@ -0,0 +1,174 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "CompiledCascade.h"
+
+// x86 only : Other targets report SIMD_NONE and always use the scalar evaluator
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HCC_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define HCC_TARGET(isa)
+#else
+#include <cpuid.h>
+#define HCC_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+using namespace std;
+using namespace cv;
+
+// ------------------------------- CPU Support --------------------------------- //
+#ifdef HCC_X86
+static void cpuid(int leaf, int info[4]) {
+#ifdef _MSC_VER
+	__cpuidex(info, leaf, 0);
+#else
+	unsigned int a, b, c, d;
+	__cpuid_count(leaf, 0, a, b, c, d);
+	info[0] = (int)a; info[1] = (int)b; info[2] = (int)c; info[3] = (int)d;
+#endif
+}
+
+// OS saves the AVX (ymm) registers on context switches
+static bool osSupportsAvx() {
+#ifdef _MSC_VER
+	return (_xgetbv(0) & 6) == 6;
+#else
+	unsigned int eax, edx;
+	__asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (eax & 6) == 6;
+#endif
+}
+#endif
+
+// Best instruction set this CPU (and OS) supports
+CompiledCascade::SimdLevel CompiledCascade::detectSimd() {
+#ifdef HCC_X86
+	int info[4];
+	cpuid(0, info);
+	int maxLeaf = info[0];
+
+	cpuid(1, info);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0 && osSupportsAvx();
+
+	bool avx2 = false;
+	if (avx && maxLeaf >= 7) {
+		cpuid(7, info);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+
+	if (avx2) return SIMD_AVX2;
+	if (sse41) return SIMD_SSE41;
+#endif
+	return SIMD_NONE;
+}
+
+// ------------------------------- Stump Evaluators --------------------------------- //
+// Both mirror evaluateWindow() for stumps operation for operation (float features, double stage sums),
+// so a lane only disagrees with the scalar path when FMA contraction moves a value across a threshold.
+
+#ifdef HCC_X86
+// Rect sum at base + ofs for 4 windows (xs) : SSE has no gather, so each lane is loaded on its own
+HCC_TARGET("sse4.1")
+static inline __m128 rectSums4(const int* base, const int* ofs, const int32_t* xs) {
+	__m128i a = _mm_setr_epi32(base[xs[0] + ofs[0]], base[xs[1] + ofs[0]], base[xs[2] + ofs[0]], base[xs[3] + ofs[0]]);
+	__m128i b = _mm_setr_epi32(base[xs[0] + ofs[1]], base[xs[1] + ofs[1]], base[xs[2] + ofs[1]], base[xs[3] + ofs[1]]);
+	__m128i c = _mm_setr_epi32(base[xs[0] + ofs[2]], base[xs[1] + ofs[2]], base[xs[2] + ofs[2]], base[xs[3] + ofs[2]]);
+	__m128i d = _mm_setr_epi32(base[xs[0] + ofs[3]], base[xs[1] + ofs[3]], base[xs[2] + ofs[3]], base[xs[3] + ofs[3]]);
+	return _mm_cvtepi32_ps(_mm_add_epi32(_mm_sub_epi32(_mm_sub_epi32(a, b), c), d));
+}
+
+// Rect sum at base + ofs for 8 windows (lanes = xs)
+HCC_TARGET("avx2")
+static inline __m256 rectSums8(const int* base, const int* ofs, __m256i lanes) {
+	__m256i a = _mm256_i32gather_epi32(base + ofs[0], lanes, 4);
+	__m256i b = _mm256_i32gather_epi32(base + ofs[1], lanes, 4);
+	__m256i c = _mm256_i32gather_epi32(base + ofs[2], lanes, 4);
+	__m256i d = _mm256_i32gather_epi32(base + ofs[3], lanes, 4);
+	return _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_sub_epi32(_mm256_sub_epi32(a, b), c), d));
+}
+
+/// <summary>
+/// Evaluate 4 windows of one row : Window l sits at sumRow + xs[l].
+/// </summary>
+/// <returns> Bit l set if window l passes every stage (only lanes in activeMask) : stageSums, if given, gets [stage][lane] sums </returns>
+HCC_TARGET("sse4.1")
+int CompiledCascade::evaluateStumpsSSE41(const int* stumpOffsets, const int* sumRow, const int* tiltedRow, const int32_t* xs, const float* varianceNormFactors, int activeMask, double* stageSums) const {
+	const __m128 vnf = _mm_loadu_ps(varianceNormFactors);
+	int mask = activeMask & 0xF;
+
+	int first = 0;
+	for (size_t s = 0; s < stumps.stageEnd.size(); s++) {
+		__m128d sumLow = _mm_setzero_pd(), sumHigh = _mm_setzero_pd();
+		for (int i = first; i < stumps.stageEnd[s]; i++) {
+			const int* ofs = stumpOffsets + i * 12;
+			const int* base = stumps.tilted[i] ? tiltedRow : sumRow;
+
+			__m128 value = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(stumps.weight0[i]), rectSums4(base, ofs, xs)), _mm_mul_ps(_mm_set1_ps(stumps.weight1[i]), rectSums4(base, ofs + 4, xs)));
+			if (stumps.weight2[i] != 0) value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(stumps.weight2[i]), rectSums4(base, ofs + 8, xs)));
+
+			__m128 goLeft = _mm_cmplt_ps(_mm_mul_ps(value, vnf), _mm_set1_ps(stumps.threshold[i]));
+			__m128 leaf = _mm_blendv_ps(_mm_set1_ps(stumps.right[i]), _mm_set1_ps(stumps.left[i]), goLeft);
+			sumLow = _mm_add_pd(sumLow, _mm_cvtps_pd(leaf));
+			sumHigh = _mm_add_pd(sumHigh, _mm_cvtps_pd(_mm_movehl_ps(leaf, leaf)));
+		}
+		first = stumps.stageEnd[s];
+		if (stageSums) {
+			_mm_storeu_pd(stageSums + s * 4, sumLow);
+			_mm_storeu_pd(stageSums + s * 4 + 2, sumHigh);
+		}
+
+		__m128d threshold = _mm_set1_pd(stumps.stageThreshold[s]);
+		mask &= _mm_movemask_pd(_mm_cmpge_pd(sumLow, threshold)) | (_mm_movemask_pd(_mm_cmpge_pd(sumHigh, threshold)) << 2);
+		if (!mask) return 0;
+	}
+	return mask;
+}
+
+/// <summary>
+/// Evaluate 8 windows of one row : Window l sits at sumRow + xs[l].
+/// </summary>
+/// <returns> Bit l set if window l passes every stage (only lanes in activeMask) : stageSums, if given, gets [stage][lane] sums </returns>
+HCC_TARGET("avx2")
+int CompiledCascade::evaluateStumpsAVX2(const int* stumpOffsets, const int* sumRow, const int* tiltedRow, const int32_t* xs, const float* varianceNormFactors, int activeMask, double* stageSums) const {
+	const __m256 vnf = _mm256_loadu_ps(varianceNormFactors);
+	const __m256i lanes = _mm256_loadu_si256((const __m256i*)xs);
+	int mask = activeMask & 0xFF;
+
+	int first = 0;
+	for (size_t s = 0; s < stumps.stageEnd.size(); s++) {
+		__m256d sumLow = _mm256_setzero_pd(), sumHigh = _mm256_setzero_pd();
+		for (int i = first; i < stumps.stageEnd[s]; i++) {
+			const int* ofs = stumpOffsets + i * 12;
+			const int* base = stumps.tilted[i] ? tiltedRow : sumRow;
+
+			__m256 value = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(stumps.weight0[i]), rectSums8(base, ofs, lanes)), _mm256_mul_ps(_mm256_set1_ps(stumps.weight1[i]), rectSums8(base, ofs + 4, lanes)));
+			if (stumps.weight2[i] != 0) value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_set1_ps(stumps.weight2[i]), rectSums8(base, ofs + 8, lanes)));
+
+			__m256 goLeft = _mm256_cmp_ps(_mm256_mul_ps(value, vnf), _mm256_set1_ps(stumps.threshold[i]), _CMP_LT_OQ);
+			__m256 leaf = _mm256_blendv_ps(_mm256_set1_ps(stumps.right[i]), _mm256_set1_ps(stumps.left[i]), goLeft);
+			sumLow = _mm256_add_pd(sumLow, _mm256_cvtps_pd(_mm256_castps256_ps128(leaf)));
+			sumHigh = _mm256_add_pd(sumHigh, _mm256_cvtps_pd(_mm256_extractf128_ps(leaf, 1)));
+		}
+		first = stumps.stageEnd[s];
+		if (stageSums) {
+			_mm256_storeu_pd(stageSums + s * 8, sumLow);
+			_mm256_storeu_pd(stageSums + s * 8 + 4, sumHigh);
+		}
+
+		__m256d threshold = _mm256_set1_pd(stumps.stageThreshold[s]);
+		mask &= _mm256_movemask_pd(_mm256_cmp_pd(sumLow, threshold, _CMP_GE_OQ)) | (_mm256_movemask_pd(_mm256_cmp_pd(sumHigh, threshold, _CMP_GE_OQ)) << 4);
+		if (!mask) return 0;
+	}
+	return mask;
+}
+
+#else
+// No x86 SIMD : detectSimd() returns SIMD_NONE so these are never reached
+int CompiledCascade::evaluateStumpsSSE41(const int*, const int*, const int*, const int32_t*, const float*, int, double*) const { return 0; }
+int CompiledCascade::evaluateStumpsAVX2(const int*, const int*, const int*, const int32_t*, const float*, int, double*) const { return 0; }
+#endif
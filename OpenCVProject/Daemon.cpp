@@ -0,0 +1,366 @@
+// Sockets first : winsock2.h must come before anything that pulls in windows.h
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef SOCKET SocketHandle;
+static const int SHUTDOWN_READ = SD_RECEIVE;
+static const int SHUTDOWN_BOTH = SD_BOTH;
+static int closeSocket(SocketHandle socket) { return closesocket(socket); }
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+typedef int SocketHandle;
+static const SocketHandle INVALID_SOCKET = -1;
+static const int SHUTDOWN_READ = SHUT_RD;
+static const int SHUTDOWN_BOTH = SHUT_RDWR;
+static int closeSocket(SocketHandle socket) { return close(socket); }
+#endif
+
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <csignal>
+#include <filesystem>
+#include <algorithm>
+
+#include "Daemon.h"
+#include "Image.h"
+#include "Log.h"
+
+#define endlog Log::printStream()
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+atomic<Daemon*> Daemon::running = nullptr;
+
+// ------------------------------- Socket IO --------------------------------- //
+static bool receiveAll(SocketHandle socket, uchar* data, size_t size) {
+	while (size > 0) {
+		int received = recv(socket, (char*)data, (int)min<size_t>(size, 1 << 20), 0);
+#ifndef _WIN32
+		if (received < 0 && errno == EINTR) continue; // Signal landed on this thread
+#endif
+		if (received <= 0) return false;
+		data += received;
+		size -= received;
+	}
+	return true;
+}
+
+static bool sendAll(SocketHandle socket, const uchar* data, size_t size) {
+	while (size > 0) {
+		int sent = send(socket, (const char*)data, (int)min<size_t>(size, 1 << 20), 0);
+#ifndef _WIN32
+		if (sent < 0 && errno == EINTR) continue;
+#endif
+		if (sent <= 0) return false;
+		data += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+static void putLength(uchar* header, uint32_t length) {
+	for (int i = 0; i < 4; i++) header[i] = (uchar)(length >> (8 * i));
+}
+
+static uint32_t getLength(const uchar* header) {
+	uint32_t length = 0;
+	for (int i = 0; i < 4; i++) length |= (uint32_t)header[i] << (8 * i);
+	return length;
+}
+
+// False on a closed connection or a payload over maxPayload (the connection is dropped : Its stream can not be resynchronized)
+bool Daemon::readRequest(intptr_t socket, Request& request) {
+	uchar header[6];
+	if (!receiveAll((SocketHandle)socket, header, sizeof(header))) return false;
+	request.type = (char)header[0];
+	request.reply = (char)header[1];
+	uint32_t length = getLength(header + 2);
+	if (length > maxPayload) return false;
+	request.payload.resize(length);
+	return length == 0 || receiveAll((SocketHandle)socket, request.payload.data(), length);
+}
+
+bool Daemon::writeReply(intptr_t socket, const Reply& reply) {
+	uchar header[5];
+	header[0] = (uchar)reply.status;
+	putLength(header + 1, (uint32_t)reply.payload.size());
+	return sendAll((SocketHandle)socket, header, sizeof(header)) && sendAll((SocketHandle)socket, reply.payload.data(), reply.payload.size());
+}
+
+Daemon::Reply Daemon::error(const string& message) {
+	Reply reply;
+	reply.status = 'E';
+	reply.payload.assign(message.begin(), message.end());
+	return reply;
+}
+
+// ------------------------------- Lifetime --------------------------------- //
+Daemon::Daemon(const string& _socketPath, int _workers, size_t queueDepth, size_t _maxConnections, function<void(Image&)> _setup)
+	: socketPath(_socketPath), workerCount(max(1, _workers)), maxConnections(max((size_t)1, _maxConnections)), jobs("daemon jobs", queueDepth), setup(_setup) {
+}
+
+/// <summary>
+/// Listen on socketPath and serve until stop() : Workers load their cascades before the first connection is accepted.
+/// </summary>
+/// <returns> Exit code : 0 = Drained and stopped : 2 = Could not listen </returns>
+int Daemon::run() {
+#ifdef _WIN32
+	WSADATA winsock;
+	if (WSAStartup(MAKEWORD(2, 2), &winsock) != 0) {
+		Log::println("[ERROR] Could not start Winsock", LOG_ERROR);
+		return 2;
+	}
+#else
+	signal(SIGPIPE, SIG_IGN); // A client hanging up mid reply must not end the daemon
+#endif
+
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+		Log::println("[ERROR] Socket path \"" + socketPath + "\" is empty or too long", LOG_ERROR);
+		return 2;
+	}
+	memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+	SocketHandle server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server == INVALID_SOCKET) {
+		Log::println("[ERROR] Could not create socket", LOG_ERROR);
+		return 2;
+	}
+
+	// A socket file nobody answers on is left over from a crash : One that answers belongs to a running daemon
+	error_code fileError;
+	if (fs::exists(socketPath, fileError)) {
+		SocketHandle probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		bool answered = probe != INVALID_SOCKET && connect(probe, (sockaddr*)&address, sizeof(address)) == 0;
+		if (probe != INVALID_SOCKET) closeSocket(probe);
+		if (answered) {
+			Log::println("[ERROR] A daemon is already listening on \"" + socketPath + "\"", LOG_ERROR);
+			closeSocket(server);
+			return 2;
+		}
+		fs::remove(socketPath, fileError);
+	}
+
+	if (::bind(server, (sockaddr*)&address, sizeof(address)) != 0 || listen(server, SOMAXCONN) != 0) {
+		Log::println("[ERROR] Could not listen on \"" + socketPath + "\"", LOG_ERROR);
+		closeSocket(server);
+		return 2;
+	}
+	listenSocket = (intptr_t)server;
+	running = this;
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	// Workers :
+	vector<thread> workers;
+	vector<future<void>> warmed;
+	for (int i = 0; i < workerCount; i++) {
+		auto ready = make_shared<promise<void>>();
+		warmed.push_back(ready->get_future());
+		workers.emplace_back([this, ready]() { work(ready.get()); });
+	}
+	for (future<void>& ready : warmed) ready.wait();
+	startlog << "Daemon : Listening on \"" << socketPath << "\" [" << workerCount << " Workers] [Queue " << jobs.stats().capacity << "]" << endl << endlog;
+	Log::flush();
+
+	// Accept : Each connection gets a reader thread (at most maxConnections), jobs go through the shared queue
+	int failures = 0;
+	while (!stopping) {
+		SocketHandle client = accept(server, nullptr, nullptr);
+		if (client == INVALID_SOCKET) {
+			if (stopping) break;
+			if (++failures > 100) {
+				Log::println("[ERROR] accept() keeps failing : Stopping", LOG_ERROR);
+				stop();
+				break;
+			}
+			continue;
+		}
+		failures = 0;
+		connectionCount++;
+		reapConnections(false);
+
+		lock_guard<mutex> lock(connectionMutex);
+		if (connections.size() >= maxConnections) {
+			// Refused before any request is read : One error reply (fits the empty send buffer, so this never blocks) then close
+			writeReply((intptr_t)client, error("too many connections"));
+			shutdown(client, SHUTDOWN_BOTH);
+			closeSocket(client);
+			refusedCount++;
+			continue;
+		}
+		connections.push_back(make_unique<Connection>());
+		Connection& connection = *connections.back();
+		connection.socket = (intptr_t)client;
+		connection.reader = thread([this, &connection]() { serve(connection); });
+	}
+	stop(); // accept() failing for good ends up here too
+
+	// Drain : Every queued job is answered before the connections are closed
+	Log::println("Daemon : Draining");
+	jobs.close();
+	for (thread& worker : workers) worker.join();
+	reapConnections(true);
+
+	fs::remove(socketPath, fileError);
+	running = nullptr;
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	return 0;
+}
+
+// Stop accepting and start draining : Safe from a signal handler (atomics, shutdown() and close() only)
+void Daemon::stop() {
+	stopping = true;
+	intptr_t server = listenSocket.exchange(-1);
+	if (server != -1) {
+		shutdown((SocketHandle)server, SHUTDOWN_BOTH); // Wakes the blocked accept()
+		closeSocket((SocketHandle)server);
+	}
+}
+
+void Daemon::onSignal(int) {
+	Daemon* daemon = running.load();
+	if (daemon) daemon->stop();
+}
+
+// Join finished readers : all = Also wake the ones waiting on a next request (drain is over) and join them
+void Daemon::reapConnections(bool all) {
+	lock_guard<mutex> lock(connectionMutex);
+	for (auto connection = connections.begin(); connection != connections.end();) {
+		if (all && !(*connection)->done) shutdown((SocketHandle)(*connection)->socket, SHUTDOWN_READ);
+		if (all || (*connection)->done) {
+			(*connection)->reader.join();
+			connection = connections.erase(connection);
+		}
+		else {
+			connection++;
+		}
+	}
+}
+
+Daemon::Stats Daemon::stats() {
+	Stats current;
+	current.jobs = jobCount;
+	current.positives = positiveCount;
+	current.errors = errorCount;
+	current.rejected = rejectedCount;
+	current.connections = connectionCount;
+	current.refused = refusedCount;
+	return current;
+}
+
+// ------------------------------- Serving --------------------------------- //
+// Reader : Requests of one connection in order, each waits for its reply before the next is read
+void Daemon::serve(Connection& connection) {
+	Request request;
+	while (readRequest(connection.socket, request)) {
+		Reply reply;
+		if (request.type == 'Q') {
+			reply.status = 'N';
+			writeReply(connection.socket, reply);
+			stop();
+			break;
+		}
+		if (stopping) {
+			reply = error("shutting down");
+		}
+		else if ((request.type != 'P' && request.type != 'I') || (request.reply != 'R' && request.reply != 'J')) {
+			reply = error("unknown request");
+		}
+		else {
+			Job job;
+			job.request = move(request);
+			future<Reply> result = job.reply.get_future();
+			if (jobs.tryPush(job)) {
+				reply = result.get();
+			}
+			else if (stopping) {
+				reply = error("shutting down");
+			}
+			else {
+				reply.status = 'B';
+				rejectedCount++;
+			}
+		}
+		if (!writeReply(connection.socket, reply) || stopping) break;
+	}
+	shutdown((SocketHandle)connection.socket, SHUTDOWN_BOTH);
+	closeSocket((SocketHandle)connection.socket);
+	connection.done = true;
+}
+
+// Worker : Owns one Image for its lifetime, so its Cascades (and their per thread classifiers) stay loaded
+void Daemon::work(promise<void>* ready) {
+	Image image;
+	setup(image);
+	for (Cascade* cascade : { &image.faceCascade, &image.eyeCascade, &image.animeFaceCascade, &image.animeEyeCascade }) {
+		if (Cascade::useCompiled && cascade->compiledClassifier()) continue;
+		cascade->classifier();
+	}
+	ready->set_value();
+
+	Job job;
+	while (jobs.pop(job)) {
+		Reply reply;
+		try {
+			reply = process(image, job.request);
+		}
+		catch (const exception& exception) {
+			reply = error(exception.what());
+		}
+		jobCount++;
+		if (reply.status == 'P') positiveCount++;
+		if (reply.status == 'E') errorCount++;
+		job.reply.set_value(move(reply));
+	}
+}
+
+// Generate one request : Rects are in the normalized image (long side 720), the same ones generateFaceImage() draws from
+Daemon::Reply Daemon::process(Image& image, const Request& request) {
+	{
+		LogKey key(LOG_GENERATE_INFO); // Loading can throw (work() answers 'E') : The key must not stay on this worker's stack
+		if (request.type == 'P') {
+			image.loadImage(string(request.payload.begin(), request.payload.end()));
+		}
+		else {
+			Mat decoded = imdecode(request.payload, IMREAD_COLOR);
+			image.loadFrame(decoded, "memory.jpg");
+		}
+		if (image.checkForOriginal) image.generateAll();
+	}
+	if (!image.checkForOriginal) return error("could not decode image");
+
+	Reply reply;
+	reply.status = image.checkForFaceImage ? 'P' : 'N';
+	if (request.reply == 'R') {
+		ostringstream text;
+		for (const vector<Rect>& rects : image.cascadeRects()) {
+			text << rects.size();
+			for (const Rect& rect : rects) text << " " << rect.x << " " << rect.y << " " << rect.width << " " << rect.height;
+			text << "\n";
+		}
+		string rects = text.str();
+		reply.payload.assign(rects.begin(), rects.end());
+	}
+	else if (image.checkForFaceImage && !imencode(".jpg", image.faceImage, reply.payload)) {
+		return error("could not encode result");
+	}
+	return reply;
+}
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <list>
+#include <memory>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include "BoundedQueue.h"
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+class Image;
+
+/// <summary>
+/// Long running worker : Cascades are loaded once per worker thread at startup, jobs arrive over a Unix domain socket (AF_UNIX, Windows 10+ included).
+/// Every connection may send any number of requests, one reply each, in order :
+///   Request : [type 1 byte] [reply 1 byte] [payload length 4 bytes LE] [payload]
+///     type  : 'P' payload is a file path : 'I' payload is an encoded image (jpg / png) : 'Q' drain and shut down
+///     reply : 'R' detection rects : 'J' rendered image (JPEG, empty on a negative)
+///   Reply   : [status 1 byte] [payload length 4 bytes LE] [payload]
+///     status : 'P' positive : 'N' negative : 'B' busy (queue full, retry) : 'E' error (payload is the message)
+///     rects payload : One line per cascade (face, eye, anime face, anime eye) : "count x y w h x y w h ..."
+/// Jobs wait in a queue of at most queueDepth : A full queue answers 'B' at once instead of stalling the client.
+/// At most maxConnections are served at once (one reader thread each) : Further ones get a single 'E' reply and are closed.
+/// Shutdown (SIGINT / SIGTERM / 'Q') stops accepting, finishes every queued job and answers it, then closes the connections.
+/// </summary>
+class Daemon {
+public:
+    struct Request {
+        char type = 0;
+        char reply = 0;
+        vector<uchar> payload;
+    };
+
+    struct Reply {
+        char status = 'E';
+        vector<uchar> payload;
+    };
+
+    struct Stats {
+        long long jobs = 0;
+        long long positives = 0;
+        long long errors = 0;
+        long long rejected = 0;
+        long long connections = 0;
+        long long refused = 0;                  // Over maxConnections
+    };
+
+private:
+    struct Job {
+        Request request;
+        promise<Reply> reply;
+    };
+
+    struct Connection {
+        intptr_t socket;
+        thread reader;
+        atomic<bool> done = false;
+    };
+
+    string socketPath;
+    int workerCount;
+    size_t maxConnections;
+    BoundedQueue<Job> jobs;
+    function<void(Image&)> setup;               // Applies the run settings to each worker's Image
+
+    atomic<intptr_t> listenSocket = -1;
+    atomic<bool> stopping = false;
+    list<unique_ptr<Connection>> connections;
+    mutex connectionMutex;
+
+    atomic<long long> jobCount = 0, positiveCount = 0, errorCount = 0, rejectedCount = 0, connectionCount = 0, refusedCount = 0;
+
+    static atomic<Daemon*> running;             // Instance the signal handler stops
+
+    void serve(Connection& connection);
+    void work(promise<void>* ready);
+    Reply process(Image& image, const Request& request);
+    void reapConnections(bool all);
+    static void onSignal(int signal);
+
+public:
+    static const size_t maxPayload = 64 * 1024 * 1024;
+
+    Daemon(const string& _socketPath, int _workers, size_t queueDepth, size_t _maxConnections, function<void(Image&)> _setup);
+
+    int run();
+    void stop();
+    Stats stats();
+
+    // Framing (shared with clients written in C++)
+    static bool readRequest(intptr_t socket, Request& request);
+    static bool writeReply(intptr_t socket, const Reply& reply);
+    static Reply error(const string& message);
+};
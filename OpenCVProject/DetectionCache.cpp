@@ -0,0 +1,221 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdio>
+
+#include "DetectionCache.h"
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+static const char* ENTRY_EXT = ".rects";
+
+/// <summary>
+/// Open (or create) the cache in directory : Existing entries are indexed oldest first by their file time,
+/// temporary files left by an interrupted run are removed.
+/// </summary>
+DetectionCache::DetectionCache(const string& _directory, size_t _maxBytes, size_t _maxEntries) : directory(_directory), maxBytes(_maxBytes), maxEntries(_maxEntries) {
+	error_code error;
+	fs::create_directories(directory, error);
+	if (!fs::is_directory(directory, error)) return;
+	valid = true;
+
+	vector<pair<fs::file_time_type, Entry>> found;
+	for (const auto& dirItem : fs::directory_iterator(directory, error)) {
+		const fs::path& file = dirItem.path();
+		if (file.extension() == ".tmp") {
+			fs::remove(file, error);
+			continue;
+		}
+		if (file.extension() != ENTRY_EXT) continue;
+
+		Entry entry;
+		string stem = file.stem().string();
+		char* end = nullptr;
+		entry.key = strtoull(stem.c_str(), &end, 16);
+		if (stem.empty() || *end != '\0') continue;
+		entry.bytes = (size_t)dirItem.file_size(error);
+		if (error) continue;
+		found.push_back({ dirItem.last_write_time(error), entry });
+	}
+
+	// Newest at the front of recent
+	sort(found.begin(), found.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+	for (const auto& [time, entry] : found) {
+		recent.push_back(entry);
+		entries[entry.key] = prev(recent.end());
+		totalBytes += entry.bytes;
+	}
+
+	// Limits may have shrunk since the last run
+	vector<uint64_t> removed;
+	evict(removed);
+	for (uint64_t key : removed) fs::remove(entryPath(key), error);
+}
+
+string DetectionCache::entryPath(uint64_t key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx%s", (unsigned long long)key, ENTRY_EXT);
+	return (fs::path(directory) / name).string();
+}
+
+// Drop least recently used entries until both limits hold : cacheMutex must be held, files are removed by the caller
+void DetectionCache::evict(vector<uint64_t>& removed) {
+	while (!recent.empty() && ((maxBytes && totalBytes > maxBytes) || (maxEntries && recent.size() > maxEntries))) {
+		Entry& oldest = recent.back();
+		totalBytes -= oldest.bytes;
+		removed.push_back(oldest.key);
+		entries.erase(oldest.key);
+		recent.pop_back();
+		evictions++;
+	}
+}
+
+// ------------------------------- Lookup / Store --------------------------------- //
+/// <summary>
+/// Rects stored for key, one list per cascade in the order they were stored.
+/// File format : One line per cascade, "count x y w h x y w h ..."
+/// </summary>
+bool DetectionCache::load(uint64_t key, vector<vector<Rect>>& rects) {
+	rects.clear();
+	{
+		lock_guard<mutex> lock(cacheMutex);
+		auto found = valid ? entries.find(key) : entries.end();
+		if (found == entries.end()) {
+			misses++;
+			return false;
+		}
+		recent.splice(recent.begin(), recent, found->second);
+	}
+
+	string path = entryPath(key);
+	ifstream file(path);
+	string line;
+	bool readable = (bool)file;
+	while (readable && getline(file, line)) {
+		istringstream fields(line);
+		size_t count = 0;
+		if (!(fields >> count)) {
+			readable = false;
+			break;
+		}
+		vector<Rect> list(count);
+		for (Rect& rect : list) {
+			if (!(fields >> rect.x >> rect.y >> rect.width >> rect.height)) readable = false;
+		}
+		rects.push_back(move(list));
+	}
+
+	if (!readable || rects.empty()) {
+		// Unreadable entry : Forget it so the next store replaces it
+		file.close();
+		lock_guard<mutex> lock(cacheMutex);
+		auto found = entries.find(key);
+		if (found != entries.end()) {
+			totalBytes -= found->second->bytes;
+			recent.erase(found->second);
+			entries.erase(found);
+		}
+		rects.clear();
+		misses++;
+		return false;
+	}
+
+	error_code error;
+	fs::last_write_time(path, fs::file_time_type::clock::now(), error); // Recency survives the run
+	hits++;
+	return true;
+}
+
+// Written to a temporary file then renamed : Readers never see half an entry
+bool DetectionCache::store(uint64_t key, const vector<vector<Rect>>& rects) {
+	if (!valid) return false;
+
+	string path = entryPath(key);
+	string tempPath = path + "." + to_string(tempCount++) + ".tmp";
+	{
+		ofstream file(tempPath, ios::trunc);
+		if (!file) return false;
+		for (const vector<Rect>& list : rects) {
+			file << list.size();
+			for (const Rect& rect : list) file << " " << rect.x << " " << rect.y << " " << rect.width << " " << rect.height;
+			file << "\n";
+		}
+		if (!file.flush()) {
+			file.close();
+			error_code error;
+			fs::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	error_code error;
+	size_t bytes = (size_t)fs::file_size(tempPath, error);
+	fs::rename(tempPath, path, error);
+	if (error) {
+		fs::remove(tempPath, error);
+		return false;
+	}
+
+	vector<uint64_t> removed;
+	{
+		lock_guard<mutex> lock(cacheMutex);
+		auto found = entries.find(key);
+		if (found != entries.end()) {
+			// Another worker stored the same image : Same rects, only the size is refreshed
+			totalBytes -= found->second->bytes;
+			recent.erase(found->second);
+			entries.erase(found);
+		}
+		recent.push_front(Entry{ key, bytes });
+		entries[key] = recent.begin();
+		totalBytes += bytes;
+		evict(removed);
+	}
+	for (uint64_t old : removed) fs::remove(entryPath(old), error);
+	stores++;
+	return true;
+}
+
+DetectionCache::Stats DetectionCache::stats() {
+	Stats current;
+	current.hits = hits;
+	current.misses = misses;
+	current.stores = stores;
+	current.evictions = evictions;
+	lock_guard<mutex> lock(cacheMutex);
+	current.entries = recent.size();
+	current.bytes = totalBytes;
+	return current;
+}
+
+// ------------------------------- Key Building --------------------------------- //
+uint64_t DetectionCache::hash(const void* data, size_t bytes, uint64_t seed) {
+	const unsigned char* byte = (const unsigned char*)data;
+	for (size_t i = 0; i < bytes; i++) {
+		seed ^= byte[i];
+		seed *= 1099511628211ull;
+	}
+	return seed;
+}
+
+uint64_t DetectionCache::hash(const string& text, uint64_t seed) {
+	return hash(text.data(), text.size(), seed);
+}
+
+// Dimensions, type and pixels (row by row : image may be a view into a larger Mat)
+uint64_t DetectionCache::hashImage(const Mat& image, uint64_t seed) {
+	int header[3] = { image.cols, image.rows, image.type() };
+	seed = hash(header, sizeof(header), seed);
+	size_t rowBytes = image.cols * image.elemSize();
+	for (int row = 0; row < image.rows; row++) {
+		seed = hash(image.ptr(row), rowBytes, seed);
+	}
+	return seed;
+}
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+/// <summary>
+/// On disk store of detection results (the rects of every cascade) keyed by a hash of the normalized pixels plus everything that decides detection
+/// (cascade files, their settings, the detection policy) : Rerunning a batch to try new rendering reads the rects here instead of detecting again.
+/// One small file per entry, so concurrent workers never rewrite a shared file. Least recently used entries are evicted past maxBytes / maxEntries,
+/// a hit touches its file so the order carries over to the next run.
+/// </summary>
+class DetectionCache {
+public:
+    struct Stats {
+        long long hits = 0;
+        long long misses = 0;
+        long long stores = 0;
+        long long evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+private:
+    struct Entry {
+        uint64_t key;
+        size_t bytes;
+    };
+
+    string directory;
+    size_t maxBytes;                // 0 = No size limit
+    size_t maxEntries;              // 0 = No entry limit
+    bool valid = false;
+
+    list<Entry> recent;             // Most recently used first
+    unordered_map<uint64_t, list<Entry>::iterator> entries;
+    size_t totalBytes = 0;
+    mutex cacheMutex;
+
+    atomic<long long> hits = 0, misses = 0, stores = 0, evictions = 0;
+    atomic<unsigned> tempCount = 0;
+
+    string entryPath(uint64_t key) const;
+    void evict(vector<uint64_t>& removed);
+
+public:
+    DetectionCache(const string& _directory, size_t _maxBytes, size_t _maxEntries = 0);
+
+    bool isValid() const { return valid; }
+    bool load(uint64_t key, vector<vector<Rect>>& rects);
+    bool store(uint64_t key, const vector<vector<Rect>>& rects);
+    Stats stats();
+
+    // Key Building : FNV-1a (64 bit), chain calls through seed
+    static const uint64_t hashSeed = 14695981039346656037ull;
+    static uint64_t hash(const void* data, size_t bytes, uint64_t seed = hashSeed);
+    static uint64_t hash(const string& text, uint64_t seed = hashSeed);
+    static uint64_t hashImage(const Mat& image, uint64_t seed = hashSeed);
+};
@@ -0,0 +1,56 @@
+#include <iostream> 
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <map>
+#include <chrono>
+
+#include "DetectionEngine.h"
+
+using namespace std;
+using namespace cv;
+
+// Microseconds since start
+static long long elapsedMicroseconds(chrono::steady_clock::time_point start) {
+	return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+}
+
+void DetectionEngine::run(const Mat& grayscaleImage, vector<DetectionJob>& jobs) {
+	for (DetectionJob& job : jobs) {
+		job.rects->clear();
+		job.microseconds = 0;
+	}
+	if (grayscaleImage.empty()) return;
+
+	// Jobs scanning each factor : Same scaleFactor = same factors, so the map merges them
+	map<double, vector<DetectionJob*>> levels;
+	for (DetectionJob& job : jobs) {
+		if (!job.cascade) continue;
+		for (double factor : job.cascade->scaleFactors(grayscaleImage.size(), job.scaleFactor, job.minSize)) {
+			levels[factor].push_back(&job);
+		}
+	}
+
+	// One level at a time : Only the integrals some job at this level needs
+	PyramidLevel level;
+	for (auto& [factor, levelJobs] : levels) {
+		bool squares = false, tilted = false;
+		for (DetectionJob* job : levelJobs) {
+			squares = squares || job->cascade->needsSquares();
+			tilted = tilted || job->cascade->needsTilted();
+		}
+		auto start = chrono::steady_clock::now();
+		CompiledCascade::buildLevel(grayscaleImage, factor, squares, tilted, level);
+		long long levelShare = elapsedMicroseconds(start) / (long long)levelJobs.size();
+		for (DetectionJob* job : levelJobs) {
+			start = chrono::steady_clock::now();
+			job->cascade->detectAtScale(level, *job->rects);
+			job->microseconds += levelShare + elapsedMicroseconds(start);
+		}
+	}
+
+	for (DetectionJob& job : jobs) {
+		auto start = chrono::steady_clock::now();
+		CompiledCascade::groupCandidates(*job.rects, job.minNeighbors);
+		job.microseconds += elapsedMicroseconds(start);
+	}
+}
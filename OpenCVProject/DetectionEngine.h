@@ -0,0 +1,30 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "CompiledCascade.h"
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+// One cascade's share of a DetectionEngine pass
+struct DetectionJob {
+    const CompiledCascade* cascade = nullptr;
+    double scaleFactor = 1.1;
+    int minNeighbors = 3;
+    Size minSize = Size(0, 0);
+    vector<Rect>* rects = nullptr;  // Output : Grouped detections in image space
+    long long microseconds = 0;     // Output : Scan + grouping time, plus an even share of each level it scanned
+};
+
+/// <summary>
+/// Runs several compiled cascades over one image with a single shared pyramid.
+/// Every scale any job needs is resized and integrated once, evaluated by each job scanning it, then dropped,
+/// so cascades with the same scaleFactor (face + anime face, eyes + anime eyes) pay for one pyramid between them.
+/// </summary>
+class DetectionEngine {
+public:
+    static void run(const Mat& grayscaleImage, vector<DetectionJob>& jobs);
+};
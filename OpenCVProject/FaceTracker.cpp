@@ -0,0 +1,68 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <algorithm>
+
+#include "FaceTracker.h"
+
+using namespace std;
+using namespace cv;
+
+// Templates of every rect (one list per cascade) on the keyframe
+void FaceTracker::start(const Mat& grayscale, const vector<vector<Rect>>& rects) {
+	tracks.clear();
+	listCount = rects.size();
+	lastConfidence = 1;
+	Rect frame(0, 0, grayscale.cols, grayscale.rows);
+	for (size_t list = 0; list < rects.size(); list++) {
+		for (const Rect& rect : rects[list]) {
+			Rect inside = rect & frame;
+			if (inside.width < 4 || inside.height < 4) continue; // Nothing to match on
+			tracks.push_back(Track{ list, inside, grayscale(inside).clone() });
+		}
+	}
+}
+
+/// <summary>
+/// Find every track in grayscale : rects gets one list per start() list, in the same order.
+/// A keyframe without rects tracks nothing with full confidence (faces entering the frame wait for the next keyframe).
+/// </summary>
+/// <returns> False if not started or any rect matched below minConfidence </returns>
+bool FaceTracker::update(const Mat& grayscale, vector<vector<Rect>>& rects) {
+	if (!isStarted()) return false;
+
+	rects.assign(listCount, {});
+	Rect frame(0, 0, grayscale.cols, grayscale.rows);
+	double weakest = 1;
+	for (Track& track : tracks) {
+		int marginX = max(2, (int)(track.rect.width * searchMargin));
+		int marginY = max(2, (int)(track.rect.height * searchMargin));
+		Rect window = Rect(track.rect.x - marginX, track.rect.y - marginY, track.rect.width + marginX * 2, track.rect.height + marginY * 2) & frame;
+		if (window.width < track.patch.cols || window.height < track.patch.rows) {
+			weakest = 0; // Left the frame
+			break;
+		}
+
+		matchTemplate(grayscale(window), track.patch, scores, TM_CCOEFF_NORMED);
+		double best;
+		Point bestAt;
+		minMaxLoc(scores, nullptr, &best, nullptr, &bestAt);
+		if (!(best >= minConfidence)) { // NaN (flat patch) counts as lost
+			weakest = 0;
+			break;
+		}
+
+		weakest = min(weakest, best);
+		track.rect = Rect(window.x + bestAt.x, window.y + bestAt.y, track.patch.cols, track.patch.rows);
+		rects[track.list].push_back(track.rect);
+	}
+
+	lastConfidence = weakest;
+	return weakest >= minConfidence;
+}
+
+void FaceTracker::reset() {
+	tracks.clear();
+	listCount = 0;
+	lastConfidence = 0;
+}
@@ -0,0 +1,39 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+/// <summary>
+/// Moves a keyframe's cascade rects across the following video frames without running the cascades.
+/// start() keeps a grayscale template of every rect, update() finds each template again (normalized cross correlation)
+/// inside a window around where it was last seen. The weakest match is the frame's confidence : Below minConfidence the caller detects again.
+/// </summary>
+class FaceTracker {
+private:
+    struct Track {
+        size_t list;            // Index of the rect list (cascade) the rect came from
+        Rect rect;              // Where it was last found
+        Mat patch;              // Keyframe template : Never updated so the track cannot drift off the face
+    };
+
+    vector<Track> tracks;
+    size_t listCount = 0;
+    double lastConfidence = 0;
+    Mat scores;                 // matchTemplate output, reused between tracks
+
+public:
+    double minConfidence = 0.6;     // TM_CCOEFF_NORMED score a rect must keep
+    double searchMargin = 0.5;      // Search window grows by this share of the rect on each side
+
+    void start(const Mat& grayscale, const vector<vector<Rect>>& rects);
+    bool update(const Mat& grayscale, vector<vector<Rect>>& rects);
+    void reset();
+
+    bool isStarted() const { return listCount > 0; }
+    double confidence() const { return lastConfidence; }
+    size_t size() const { return tracks.size(); }
+};
@@ -3,8 +3,14 @@
 #include <math.h>
 #include <vector>
 #include <string>
+#include <future>
+#include <tuple>
+#include <fstream>
+#include <sstream>
 
 #include "Image.h"
+#include "TaskPool.h"
+#include "FaceTracker.h"
 #include "Log.h"
 
 #define endlog Log::printStream()
@@ -12,17 +18,25 @@
 using namespace std;
 using namespace cv;
 
-//const string Image::frontalFaceCascadePath = ".\\Resources\\HaarCascade\\haarcascade_frontalface_tree_alt.xml";
-const string Image::frontalFaceCascadePath = ".\\Resources\\HaarCascade\\haarcascade_frontalface.xml";
-const string Image::eyeCascadePath = ".\\Resources\\HaarCascade\\haarcascade_eyes_update.xml";
-const string Image::animeFaceCascadePath = ".\\Resources\\HaarCascade\\haarcascade_anime_face.xml";
-const string Image::animeEyeCascadePath = ".\\Resources\\HaarCascade\\haarcascade_anime_eyes.xml";
+//const string Image::frontalFaceCascadePath = "./Resources/HaarCascade/haarcascade_frontalface_tree_alt.xml";
+const string Image::frontalFaceCascadePath = "./Resources/HaarCascade/haarcascade_frontalface.xml";
+const string Image::eyeCascadePath = "./Resources/HaarCascade/haarcascade_eyes_update.xml";
+const string Image::animeFaceCascadePath = "./Resources/HaarCascade/haarcascade_anime_face.xml";
+const string Image::animeEyeCascadePath = "./Resources/HaarCascade/haarcascade_anime_eyes.xml";
 
-Image::Image(string _path) {
-	path = _path;
-	size = Size(720,720); // Default Size goes here for now i guess
+bool Image::reducedDecode = true;
+DetectionCache* Image::detectionCache = nullptr;
+Mat Image::mustacheOverlay;
 
-	loadImage(path);
+// Long lived threads for parallelCascades : Kept alive so each loads its classifiers once
+static TaskPool& cascadePool() {
+	static TaskPool pool(3);
+	return pool;
+}
+
+// Settings and Cascades only : Nothing is decoded until loadImage() / loadFrame()
+Image::Image() {
+	size = Size(720,720); // Default Size goes here for now i guess
 
 	// CHANGE THESE TO ADJUST SENSITIVITY
 
@@ -41,22 +55,35 @@ Image::Image(string _path) {
 
 }
 
+Image::Image(string _path) : Image() {
+	path = _path;
+	loadImage(path);
+}
+
 void Image::generateAll() {
 	generateNormalizedImage();
-	generateGrayscaleImage();
-	generateCascades();
+	// Cached rects skip grayscale and every cascade : Rendering below still runs
+	if (!loadCachedCascades()) {
+		generateGrayscaleImage();
+		generateCascades();
+		storeCachedCascades();
+	}
+	else if (debugDrawing) {
+		generateGrayscaleImage(); // drawDebugAllCascades() scans it : Built before generateFaceImage() draws onto the frame
+	}
 	generateFaceImage();
 	//generateProfileImage(); ?? TODO
 }
 
-// Reset Function with New Path
-void Image::loadImage(string _path) {
-
+// Clear everything of the previous image / frame : path names the image (name and ext come from it)
+void Image::resetImage(string _path) {
 	path = _path;
-	name = path.substr(path.rfind('\\') + 1, path.rfind('.') - path.rfind('\\') - 1);
+	size_t folderEnd = path.find_last_of("\\/") + 1; // npos + 1 = 0 : No folder
+	name = path.substr(folderEnd, path.rfind('.') - folderEnd);
 	ext = path.substr(path.rfind('.'));
+	rng.seed((unsigned)hash<string>{}(name)); // Same pupils for the same image regardless of thread or order
 
-	Log::stream << "Load Image : \"" << path << "\" : " << endlog;
+	logto(LOG_GENERATE_INFO) << "Load Image : \"" << path << "\" : " << endlog;
 
 	// Reset Data Checks :
 	original.release();
@@ -66,122 +93,417 @@ void Image::loadImage(string _path) {
 	grayscale.release();
 	checkForGrayscale = false;
 	checkForCascades = false;
+	cachedCascades = false;
 	faceImage.release();
 	checkForFaceImage = false;
 	profileImage.release();
 	checkForProfileImage = false;
 	debugImage.release();
 	checkForDebugImage = false;
+	timings.reset(path);
+	for (Cascade* cascade : { &faceCascade, &eyeCascade, &animeFaceCascade, &animeEyeCascade }) {
+		cascade->rects.clear();			// Keeps capacity for the next image
+		cascade->debugRects.clear();
+		cascade->detectMicroseconds = -1;
+	}
+}
 
-	original = imread(path);
+// Reset Function with New Path
+void Image::loadImage(string _path) {
+	resetImage(_path);
+
+	int reduction = reducedDecode ? decodeReduction(path) : 1;
+	{
+		StageTimer timer(timings.microseconds[STAGE_DECODE]);
+		switch (reduction) {
+		case 8: original = imread(path, IMREAD_REDUCED_COLOR_8); break;
+		case 4: original = imread(path, IMREAD_REDUCED_COLOR_4); break;
+		case 2: original = imread(path, IMREAD_REDUCED_COLOR_2); break;
+		default: original = imread(path); break;
+		}
+	}
+	timings.size = original.size();
+	timings.decodeReduction = reduction;
 
 	if (original.empty()) {
-		Log::stream << "[-Failed-]" << endl << endlog;
+		logto(LOG_GENERATE_INFO) << "[-Failed-]" << endl << endlog;
 	}
 	else {
-		Log::stream << "[-Successful-]" << endl << endlog;
+		if (reduction > 1) {
+			logto(LOG_GENERATE_INFO) << "[1/" << reduction << " Decode] " << endlog;
+		}
+		logto(LOG_GENERATE_INFO) << "[-Successful-]" << endl << endlog;
 		checkForOriginal = true;
 	}
+}
+
+// Video : frame (already decoded by VideoCapture) becomes the original, name / rng come from the video path so every frame draws alike
+void Image::loadFrame(const Mat& frame, string videoPath) {
+	resetImage(videoPath);
+	original = frame;
+	timings.size = original.size();
+	checkForOriginal = !original.empty();
+	logto(LOG_GENERATE_INFO) << (checkForOriginal ? "[Frame] [-Successful-]" : "[Frame] [-Failed-]") << endl << endlog;
+}
+
+/// <summary>
+/// Largest JPEG DCT scale (1/2, 1/4, 1/8) that still leaves the long side at least as big as size.
+/// Only JPEGs scale during decoding : Anything else (or an unreadable header) decodes at full resolution.
+/// </summary>
+/// <returns> 8, 4, 2 or 1 (full decode) </returns>
+int Image::decodeReduction(const string& path) {
+	Size fileSize;
+	if (!readJpegSize(path, fileSize)) return 1;
+
+	// Long side : EXIF rotation may swap width and height after decoding
+	int longSide = max(fileSize.width, fileSize.height);
+	int targetSide = max(size.width, size.height);
+	for (int reduction = 8; reduction > 1; reduction /= 2) {
+		if (longSide / reduction >= targetSide) return reduction;
+	}
+	return 1;
+}
+
+// Big endian 16 bit JPEG field : -1 at end of file
+static int readJpegWord(ifstream& file) {
+	int high = file.get();
+	int low = file.get();
+	if (high == EOF || low == EOF) return -1;
+	return (high << 8) | low;
+}
 
-	Log::popKey();
+// Frame size from the JPEG SOF marker : False if path is not a JPEG or has no SOF before the scan data
+bool Image::readJpegSize(const string& path, Size& fileSize) {
+	ifstream file(path, ios::binary);
+	if (file.get() != 0xFF || file.get() != 0xD8) return false;
+
+	while (file) {
+		// Marker : 0xFF (fill bytes allowed) then marker code
+		if (file.get() != 0xFF) return false;
+		int marker = file.get();
+		while (marker == 0xFF) marker = file.get();
+		if (marker == EOF || marker == 0xD9 || marker == 0xDA) return false; // EOI / SOS : No frame header
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) continue;  // No length
+
+		int length = readJpegWord(file);
+		if (length < 2) return false; // Also EOF
+
+		// SOF0 - SOF15 except DHT (C4), JPG (C8) and DAC (CC)
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			if (file.get() == EOF) return false; // Precision
+			int height = readJpegWord(file);
+			int width = readJpegWord(file);
+			if (!file || width <= 0 || height <= 0) return false;
+			fileSize = Size(width, height);
+			return true;
+		}
+		file.seekg(length - 2, ios::cur);
+	}
+	return false;
 }
 
 void Image::generateNormalizedImage() {
+	StageTimer timer(timings.microseconds[STAGE_NORMALIZE]);
 
 	// Requires Original :
-	Log::stream << "Normalized Image : " << endlog;
+	logto(LOG_GENERATE_INFO) << "Normalized Image : " << endlog;
 	if (!checkForOriginal) {
-		Log::stream << "[-Failed-] (CheckForOriginal required)" << endl << endlog;
+		logto(LOG_GENERATE_INFO) << "[-Failed-] (CheckForOriginal required)" << endl << endlog;
 	}
 
 	// Requires Size Property
 	if (size == Size(0, 0)) {
-		Log::stream << "[-Failed-] (Invalid Size)" << endl << endlog;
+		logto(LOG_GENERATE_INFO) << "[-Failed-] (Invalid Size)" << endl << endlog;
 	}
 
 	Size targetSize = size;
 
-	normalized = original.clone();
 	// If image width > image height
 	if (original.cols > original.rows) {
 		// Change the width to target size
 
 		// Aspect Height
-		int aspectHeight = (int)(((float)targetSize.width / (float)normalized.cols) * (float)normalized.rows);
+		int aspectHeight = (int)(((float)targetSize.width / (float)original.cols) * (float)original.rows);
 
 		// If width > target size -> Shrinking
 		if (original.cols > targetSize.width) {
-			resize(normalized, normalized, Size(targetSize.width, aspectHeight), INTER_AREA);
+			resize(original, normalized, Size(targetSize.width, aspectHeight), INTER_AREA);
 		}
 		else {
-			resize(normalized, normalized, Size(targetSize.width, aspectHeight), INTER_CUBIC);
+			resize(original, normalized, Size(targetSize.width, aspectHeight), INTER_CUBIC);
 		}
 	}
 	else {
 		// Change the height to target size
 
 		// Aspect Width
-		int aspectWidth = (int)(((float)targetSize.height / (float)normalized.rows) * (float)normalized.cols);
+		int aspectWidth = (int)(((float)targetSize.height / (float)original.rows) * (float)original.cols);
 
 		// If height > target size -> Shrinking
 		if (original.cols > targetSize.width) {
-			resize(normalized, normalized, Size(aspectWidth, targetSize.height), INTER_AREA);
+			resize(original, normalized, Size(aspectWidth, targetSize.height), INTER_AREA);
 		}
 		else {
-			resize(normalized, normalized, Size(aspectWidth, targetSize.height), INTER_CUBIC);
+			resize(original, normalized, Size(aspectWidth, targetSize.height), INTER_CUBIC);
 		}
 	}
-	Log::stream << "[" << normalized.rows << "," << normalized.cols << "] : " << "[-Successful-]" << endl;
-	debugImage = normalized.clone();
-	faceImage = normalized.clone();
+	logto(LOG_GENERATE_INFO) << "[" << normalized.rows << "," << normalized.cols << "] : " << "[-Successful-]" << endl;
+	// faceImage shares normalized's pixels (no copy) : generateFaceImage() drops normalized once it draws, so it is never read with the overlay on it
+	faceImage = normalized;
+	if (debugDrawing) debugImage = normalized.clone();
+	original.release(); // Full resolution frame is not needed past here : Keeps queued Images small
 	checkForNormalized = true;
 }
 
 void Image::generateGrayscaleImage() {
+	StageTimer timer(timings.microseconds[STAGE_GRAYSCALE]);
 
 	// Requires Normalized :
-	Log::stream << "Grayscale Image : " << endlog;
+	logto(LOG_GENERATE_INFO) << "Grayscale Image : " << endlog;
 	if (!checkForNormalized) {
-		Log::stream << "[-Failed-] (checkForNormalized required)" << endl << endlog;
+		logto(LOG_GENERATE_INFO) << "[-Failed-] (checkForNormalized required)" << endl << endlog;
 		return;
 	}
 
 	cvtColor(normalized, grayscale, COLOR_BGR2GRAY);
-	Log::stream << "[-Successful-]" << endl << endlog;
+	logto(LOG_GENERATE_INFO) << "[-Successful-]" << endl << endlog;
 	checkForGrayscale = true;
 }
 
 void Image::generateCascades() {
-	Log::pushKey("CASCADE");
-	Log::stream << "Detetect Multi Scale : Cascading : " << endlog;
+	Log::pushKey(LOG_CASCADE);
+	logto(LOG_CASCADE) << "Detetect Multi Scale : Cascading : " << endlog;
 
 	// Requires grayscale :
 	if (!checkForGrayscale) {
-		Log::stream << "[-Failed-] (checkForGrayscale required)" << endl << endlog;
+		logto(LOG_CASCADE) << "[-Failed-] (checkForGrayscale required)" << endl << endlog;
+		Log::popKey(); // CASCADE
 		return;
 	}
 
-	// Run Face Detection :
-	faceCascade.detectMultiScale(grayscale); Log::print("-");
-	animeFaceCascade.detectMultiScale(grayscale); Log::print("-");
-	// Run Eye Detection :
-	eyeCascade.detectMultiScale(grayscale); Log::print("-");
-	animeEyeCascade.detectMultiScale(grayscale); Log::print("-");
+	cascadeRuns = 0;
+	skippedCascades = 0;
 
-	Log::stream << " : [-Successful-]" << endl << endlog;
+	DetectionPolicy policy = detectionPolicy;
+	if (policy == DETECT_AUTO) {
+		policy = looksAnime() ? DETECT_ANIME_FIRST : DETECT_REAL_FIRST;
+	}
+
+	if (policy == DETECT_BOTH && parallelCascades) {
+		// Each task writes only its own Cascade : The deferred task runs on this thread (in wait()) instead of idling
+		vector<future<int>> tasks;
+		if (faceRegionEyes) {
+			// Eyes depend on faces : Run the real and anime pairs side by side
+			tasks.push_back(cascadePool().submit([this]() { return runFaceEyePair(faceCascade, eyeCascade, eyeRegionHeight); }));
+			tasks.push_back(async(launch::deferred, [this]() { return runFaceEyePair(animeFaceCascade, animeEyeCascade, animeEyeRegionHeight); }));
+		}
+		else {
+			tasks.push_back(cascadePool().submit([this]() { faceCascade.detectMultiScale(grayscale); return 1; }));
+			tasks.push_back(cascadePool().submit([this]() { animeFaceCascade.detectMultiScale(grayscale); return 1; }));
+			tasks.push_back(cascadePool().submit([this]() { eyeCascade.detectMultiScale(grayscale); return 1; }));
+			tasks.push_back(async(launch::deferred, [this]() { animeEyeCascade.detectMultiScale(grayscale); return 1; }));
+		}
+		// Wait for every task before get() can rethrow : Tasks reference this Image
+		// Reverse so the deferred task runs here first while the pool works on the rest
+		for (auto task = tasks.rbegin(); task != tasks.rend(); task++) {
+			task->wait();
+		}
+		for (future<int>& task : tasks) {
+			cascadeRuns += task.get();
+		}
+	}
+	else if (policy == DETECT_BOTH && faceRegionEyes) {
+		// Both face cascades share one pyramid, eyes then search inside their faces
+		Cascade::detectShared(grayscale, { &faceCascade, &animeFaceCascade });
+		cascadeRuns += 2;
+		for (auto [face, eye, regionHeight] : { make_tuple(&faceCascade, &eyeCascade, eyeRegionHeight), make_tuple(&animeFaceCascade, &animeEyeCascade, animeEyeRegionHeight) }) {
+			if (face->rects.empty()) {
+				eye->rects.clear();
+				continue;
+			}
+			eye->detectInRegions(grayscale, face->rects, regionHeight);
+			cascadeRuns++;
+		}
+	}
+	else if (policy == DETECT_BOTH) {
+		// Cascades with the same scaleFactor share pyramid levels
+		Cascade::detectShared(grayscale, { &faceCascade, &eyeCascade, &animeFaceCascade, &animeEyeCascade });
+		cascadeRuns += 4;
+	}
+	else {
+		// Early Exit : Second pair only runs if the first did not find a face with two eyes
+		bool realFirst = (policy == DETECT_REAL_FIRST);
+		Cascade& firstFace = realFirst ? faceCascade : animeFaceCascade;
+		Cascade& firstEye = realFirst ? eyeCascade : animeEyeCascade;
+		Cascade& secondFace = realFirst ? animeFaceCascade : faceCascade;
+		Cascade& secondEye = realFirst ? animeEyeCascade : eyeCascade;
+
+		cascadeRuns += runFaceEyePair(firstFace, firstEye, realFirst ? eyeRegionHeight : animeEyeRegionHeight);
+		if (pairFound(firstFace, firstEye)) {
+			secondFace.rects.clear();
+			secondEye.rects.clear();
+		}
+		else {
+			cascadeRuns += runFaceEyePair(secondFace, secondEye, realFirst ? animeEyeRegionHeight : eyeRegionHeight);
+		}
+	}
+	skippedCascades = 4 - cascadeRuns;
+	timings.microseconds[STAGE_FACE_CASCADE] = faceCascade.detectMicroseconds;
+	timings.microseconds[STAGE_EYE_CASCADE] = eyeCascade.detectMicroseconds;
+	timings.microseconds[STAGE_ANIME_FACE_CASCADE] = animeFaceCascade.detectMicroseconds;
+	timings.microseconds[STAGE_ANIME_EYE_CASCADE] = animeEyeCascade.detectMicroseconds;
+
+	// One mark per cascade : "-" ran, "x" skipped
+	logto(LOG_CASCADE) << string(cascadeRuns, '-') << string(skippedCascades, 'x') << " : [-Successful-]" << endl << endlog;
 	checkForCascades = true;
 
 	Log::popKey(); // CASCADE
 }
 
+// Rects of an earlier run with the same pixels and detection settings : False = detect as usual
+bool Image::loadCachedCascades() {
+	if (!detectionCache || !checkForNormalized) return false;
+	detectionCacheKey = detectionKey();
+
+	vector<vector<Rect>> rects;
+	if (!detectionCache->load(detectionCacheKey, rects) || !setCascadeRects(move(rects))) return false;
+	cachedCascades = true;
+
+	Log::pushKey(LOG_CASCADE);
+	logto(LOG_CASCADE) << "Detetect Multi Scale : Cached : [-Successful-]" << endl << endlog;
+	Log::popKey(); // CASCADE
+	return true;
+}
+
+void Image::storeCachedCascades() {
+	if (!detectionCache || !checkForCascades) return;
+	detectionCache->store(detectionCacheKey, cascadeRects());
+}
+
+/// <summary>
+/// Video : Move the keyframe's rects to this frame with tracker instead of running the cascades.
+/// </summary>
+/// <returns> False if tracking is lost (a rect matched below tracker.minConfidence) : Run generateCascades() and restart tracker </returns>
+bool Image::trackCascades(FaceTracker& tracker) {
+	if (!checkForGrayscale) return false;
+	vector<vector<Rect>> rects;
+	bool tracked;
+	{
+		StageTimer timer(timings.microseconds[STAGE_TRACK]);
+		tracked = tracker.update(grayscale, rects);
+	}
+	if (!tracked) return false;
+
+	setCascadeRects(move(rects));
+	logto(LOG_CASCADE) << "Tracked : [" << tracker.confidence() << " Confidence] : [-Successful-]" << endl << endlog;
+	return true;
+}
+
+// Rects of every cascade : face, eye, anime face, anime eye
+vector<vector<Rect>> Image::cascadeRects() const {
+	return { faceCascade.rects, eyeCascade.rects, animeFaceCascade.rects, animeEyeCascade.rects };
+}
+
+// Use rects (cascadeRects() order) as this image's detection without running a cascade
+bool Image::setCascadeRects(vector<vector<Rect>>&& rects) {
+	if (rects.size() != 4) return false;
+	faceCascade.rects = move(rects[0]);
+	eyeCascade.rects = move(rects[1]);
+	animeFaceCascade.rects = move(rects[2]);
+	animeEyeCascade.rects = move(rects[3]);
+	cascadeRuns = 0;
+	skippedCascades = 0;
+	checkForCascades = true;
+	return true;
+}
+
+// Every setting that changes which rects generateCascades() finds (parallelCascades does not)
+string Image::detectionSettings() {
+	ostringstream settings;
+	settings << detectionPolicy << ":" << faceRegionEyes << ":" << eyeRegionHeight << ":" << animeEyeRegionHeight << ":" << animeFlatness;
+	for (const Cascade* cascade : { &faceCascade, &eyeCascade, &animeFaceCascade, &animeEyeCascade }) {
+		settings << "|" << cascade->identity();
+	}
+	return settings.str();
+}
+
+// Normalized pixels + detection settings
+uint64_t Image::detectionKey() {
+	return DetectionCache::hash(detectionSettings(), DetectionCache::hashImage(normalized));
+}
+
+// Detection settings alone : Results kept without their pixels (ProcessedIndex) only hold while this stays the same
+uint64_t Image::settingsKey() {
+	return DetectionCache::hash(detectionSettings());
+}
+
+/// <summary>
+/// Face cascade then eye cascade : Eyes only search inside faces when faceRegionEyes is set.
+/// With parallelCascades (and full frame eyes) the two run concurrently.
+/// </summary>
+/// <returns> Number of cascades that ran (eyes are skipped when faceRegionEyes finds no face) </returns>
+int Image::runFaceEyePair(Cascade& face, Cascade& eye, double eyeRegionHeight) {
+	if (faceRegionEyes) {
+		face.detectMultiScale(grayscale);
+		if (face.rects.empty()) {
+			eye.rects.clear();
+			return 1;
+		}
+		eye.detectInRegions(grayscale, face.rects, eyeRegionHeight);
+	}
+	else if (parallelCascades) {
+		future<void> faceTask = cascadePool().submit([this, &face]() { face.detectMultiScale(grayscale); });
+		eye.detectMultiScale(grayscale);
+		faceTask.get();
+	}
+	else {
+		face.detectMultiScale(grayscale);
+		eye.detectMultiScale(grayscale);
+	}
+	return 2;
+}
+
+// If the largest face has exactly two eyes (same check generateFaceImage() draws with)
+bool Image::pairFound(Cascade& face, Cascade& eye) {
+	if (face.rects.empty()) return false;
+	vector<Rect> eyes = eye.rects; // eyesInLargestFace() erases eyes : Keep rects for drawing
+	Rect largestFace;
+	return eyesInLargestFace(face.rects, eyes, largestFace) == 2;
+}
+
+/// <summary>
+/// Cheap guess if the image is drawn : Anime art is mostly flat color so most neighbouring pixels are (nearly) equal.
+/// Only used to pick which cascade pair runs first with DETECT_AUTO, so a wrong guess costs time, never matches.
+/// </summary>
+bool Image::looksAnime() {
+	Mat sample;
+	resize(grayscale, sample, Size(64, 64), 0, 0, INTER_AREA);
+
+	int flat = 0;
+	int total = 0;
+	for (int y = 0; y < sample.rows - 1; y++) {
+		const uchar* row = sample.ptr<uchar>(y);
+		const uchar* nextRow = sample.ptr<uchar>(y + 1);
+		for (int x = 0; x < sample.cols - 1; x++) {
+			int dx = abs(row[x + 1] - row[x]);
+			int dy = abs(nextRow[x] - row[x]);
+			if (dx <= 2 && dy <= 2) flat++;
+			total++;
+		}
+	}
+	return total > 0 && (double)flat / total >= animeFlatness;
+}
+
 void Image::generateFaceImage() {
+	StageTimer timer(timings.microseconds[STAGE_FACE_IMAGE]);
 	
-	Log::pushKey("FACE");
-	Log::stream << "Face Image : " << endlog;
+	Log::pushKey(LOG_FACE);
+	logto(LOG_FACE) << "Face Image : " << endlog;
 	
 	// Requires cascades
 	if (!checkForCascades) {
-		Log::stream << "[-Failed-] (checkForCascades required)" << endl << endlog;
+		logto(LOG_FACE) << "[-Failed-] (checkForCascades required)" << endl << endlog;
+		Log::popKey(); // FACE
 		return;
 	}
 
@@ -196,14 +518,14 @@ void Image::generateFaceImage() {
 		}*/
 
 		if (numEyes == 2) {
-			Log::stream << "Requirements [default face] have been met : [-Successful-] " << endlog;
+			logto(LOG_FACE) << "Requirements [default face] have been met : [-Successful-] " << endlog;
 			checkForFaceImage = true;
 			// Requirements have been met to draw features
 			Rect face = largestFace;
 			Rect eyeL = (eyeCascade.rects.at(0).x < eyeCascade.rects.at(1).x) ? eyeCascade.rects.at(0) : eyeCascade.rects.at(1);
 			Rect eyeR = (eyeL == eyeCascade.rects.at(1)) ? eyeCascade.rects.at(0) : eyeCascade.rects.at(1);
 
-			Log::pushKey("DRAW_FACE");
+			Log::pushKey(LOG_DRAW_FACE);
 			drawFace(face, eyeL, eyeR);
 			Log::popKey(); // DRAW_FACE
 		}
@@ -218,19 +540,24 @@ void Image::generateFaceImage() {
 		}*/
 
 		if (numAnimeEyes == 2) {
-			Log::stream << "Requirements [anime face] have been met : [-Successful-] " << endlog;
+			logto(LOG_FACE) << "Requirements [anime face] have been met : [-Successful-] " << endlog;
 			checkForFaceImage = true;
 			// Requirements have been met to draw features
 			Rect face = largestAnimeFace;
 			Rect eyeL = (animeEyeCascade.rects.at(0).x < animeEyeCascade.rects.at(1).x) ? animeEyeCascade.rects.at(0) : animeEyeCascade.rects.at(1);
 			Rect eyeR = (eyeL == animeEyeCascade.rects.at(1)) ? animeEyeCascade.rects.at(0) : animeEyeCascade.rects.at(1);
 
-			Log::pushKey("DRAW_FACE");
+			Log::pushKey(LOG_DRAW_FACE);
 			drawFace(face, eyeL, eyeR);
 			Log::popKey(); // DRAW_FACE
 		}
 	}
-	Log::print("\n");
+	// Drawn : The shared pixels now carry the overlay, only faceImage names them (grayscale was built before drawing)
+	if (checkForFaceImage) {
+		normalized.release();
+		checkForNormalized = false;
+	}
+	Log::print("\n", LOG_FACE);
 	Log::popKey(); // FACE
 }
 
@@ -289,8 +616,7 @@ void Image::drawFace(Rect face, Rect eyeL, Rect eyeR) {
 	// Draw Right Eye :
 	int eyeRightX = eyeR.x + eyeR.width / 2, eyeRightY = eyeR.y + eyeR.height / 2, eyeRightR = eyeR.width / 2;
 	
-	// Configure Rand for Offset
-	srand(time(NULL));
+	// Rand for Offset : rng is seeded per image in loadImage()
 	float maxOffsetX = 3; // 1/maxOffset = %ofRadius offset
 	float maxOffsetY = 4; // 1/maxOffset = %ofRadius offset
 
@@ -298,19 +624,20 @@ void Image::drawFace(Rect face, Rect eyeL, Rect eyeR) {
 
 	// Draw Left Pupil
 	int pupilLeftR = eyeLeftR / dialation * eyeScale;
-	int leftOffsetX = -1 * (rand() % (int)(eyeLeftR / maxOffsetX));
-	int leftOffsetY = (rand() % (int)(2 * eyeLeftR / maxOffsetY)) - (int)(eyeLeftR / maxOffsetY);
+	int leftOffsetX = -1 * (int)(rng() % (int)(eyeLeftR / maxOffsetX));
+	int leftOffsetY = (int)(rng() % (int)(2 * eyeLeftR / maxOffsetY)) - (int)(eyeLeftR / maxOffsetY);
 
 	// Draw Right Pupil
 	int pupilRightR = eyeRightR / dialation * eyeScale;
-	int RightOffsetX = rand() % (int)(eyeRightR / maxOffsetX);
-	int RightOffsetY = (rand() % (int)(2 * eyeRightR / maxOffsetY)) - (int)(eyeRightR / maxOffsetY);
+	int RightOffsetX = (int)(rng() % (int)(eyeRightR / maxOffsetX));
+	int RightOffsetY = (int)(rng() % (int)(2 * eyeRightR / maxOffsetY)) - (int)(eyeRightR / maxOffsetY);
 
 	// Calculate mouth angle :
-	line(debugImage, Point(eyeRightX, eyeRightY), Point(eyeLeftX, eyeLeftY), Scalar(255, 0, 0)); // Eye line
-
 	Point eyeCenter = Point((eyeRightX + eyeLeftX) / 2, (eyeRightY + eyeLeftY) / 2);
-	circle(debugImage, eyeCenter, 3, Scalar(0,0,0), -1); // Eye center
+	if (debugDrawing) {
+		line(debugImage, Point(eyeRightX, eyeRightY), Point(eyeLeftX, eyeLeftY), Scalar(255, 0, 0)); // Eye line
+		circle(debugImage, eyeCenter, 3, Scalar(0,0,0), -1); // Eye center
+	}
 
 	double lengthScale = 0.8;
 	
@@ -319,7 +646,7 @@ void Image::drawFace(Rect face, Rect eyeL, Rect eyeR) {
 
 	Point endPoint = Point(eyeCenter.x + eyeYDist, eyeCenter.y + eyeXDist);
 	Point lengthPoint = Point(eyeCenter.x + lengthScale * (eyeYDist), eyeCenter.y + lengthScale * (eyeRightX - eyeLeftX));
-	line(debugImage, eyeCenter, endPoint, Scalar(255, 255, 255)); // Eye perpendicular
+	if (debugDrawing) line(debugImage, eyeCenter, endPoint, Scalar(255, 255, 255)); // Eye perpendicular
 
 	double angle = -atan((double)(eyeLeftY - eyeRightY) / (double)(eyeRightX - eyeLeftX)) * 180 / 3.141592;
 	int width = (eyeXDist + eyeScale * (eyeRightR + eyeLeftR));
@@ -328,28 +655,39 @@ void Image::drawFace(Rect face, Rect eyeL, Rect eyeR) {
 	RotatedRect teethBound = RotatedRect(Point(lengthPoint.x - (0.11*eyeXDist), lengthPoint.y + (0.13*eyeXDist)) , Size(width * 0.6, height * 0.9), angle);
 	RotatedRect mouthBound = RotatedRect(lengthPoint, Size(width, height), angle);
 
+	// Overlay Bounds : Every feature, plus a pixel for anti-aliased edges
+	int eyeLeftOuter = eyeLeftR * eyeScale + 2, eyeRightOuter = eyeRightR * eyeScale + 2;
+	Rect bounds = teethBound.boundingRect() | mouthBound.boundingRect()
+		| Rect(eyeLeftX - eyeLeftOuter, eyeLeftY - eyeLeftOuter, eyeLeftOuter * 2, eyeLeftOuter * 2)
+		| Rect(eyeRightX - eyeRightOuter, eyeRightY - eyeRightOuter, eyeRightOuter * 2, eyeRightOuter * 2);
+	overlay.begin(Rect(bounds.x - 1, bounds.y - 1, bounds.width + 2, bounds.height + 2), faceImage.size());
+
 	// Draw Teeth
-	ellipse(faceImage, teethBound, Scalar(255, 255, 255), -1);
-	ellipse(faceImage, teethBound, eyeOutlineColor, 1);
+	overlay.drawEllipse(teethBound, Scalar(255, 255, 255), -1);
+	overlay.drawEllipse(teethBound, eyeOutlineColor, 1);
 	// Draw Mustache
-	ellipse(faceImage, mouthBound, Scalar(0, 0, 0), -1);
+	if (!mustacheOverlay.empty()) overlay.drawImage(mustacheOverlay, mouthBound);
+	else overlay.drawEllipse(mouthBound, Scalar(0, 0, 0), -1);
 	// Draw Left Eye
-	circle(faceImage, Point(eyeLeftX, eyeLeftY), eyeLeftR * eyeScale, eyeWhiteColor, -1);
-	circle(faceImage, Point(eyeLeftX, eyeLeftY), eyeLeftR * eyeScale, eyeOutlineColor, 1);
+	overlay.drawCircle(Point(eyeLeftX, eyeLeftY), eyeLeftR * eyeScale, eyeWhiteColor, -1);
+	overlay.drawCircle(Point(eyeLeftX, eyeLeftY), eyeLeftR * eyeScale, eyeOutlineColor, 1);
 	// Draw Right Eye
-	circle(faceImage, Point(eyeRightX, eyeRightY), eyeRightR * eyeScale, eyeWhiteColor, -1);
-	circle(faceImage, Point(eyeRightX, eyeRightY), eyeRightR * eyeScale, eyeOutlineColor, 1);
+	overlay.drawCircle(Point(eyeRightX, eyeRightY), eyeRightR * eyeScale, eyeWhiteColor, -1);
+	overlay.drawCircle(Point(eyeRightX, eyeRightY), eyeRightR * eyeScale, eyeOutlineColor, 1);
 	// Draw Left Pupil
-	circle(faceImage, Point(eyeLeftX + leftOffsetX, eyeLeftY + leftOffsetY), pupilLeftR, eyePupilColor, -1);
+	overlay.drawCircle(Point(eyeLeftX + leftOffsetX, eyeLeftY + leftOffsetY), pupilLeftR, eyePupilColor, -1);
 	// Draw Right Pupil
-	circle(faceImage, Point(eyeRightX + RightOffsetX, eyeRightY + RightOffsetY), pupilRightR, eyePupilColor, -1);
+	overlay.drawCircle(Point(eyeRightX + RightOffsetX, eyeRightY + RightOffsetY), pupilRightR, eyePupilColor, -1);
 	// Draw Eyebrows
 
+	// Blend : One pass over the face region
+	overlay.composite(faceImage);
+
 }
 
 void Image::drawDebugCascades() {
 
-	if (!checkForCascades) return;
+	if (!checkForCascades || !debugDrawing) return;
 
 	drawRectList(debugImage, faceCascade.rects, faceCascade.color);
 	drawRectList(debugImage, eyeCascade.rects, eyeCascade.color);
@@ -360,10 +698,10 @@ void Image::drawDebugCascades() {
 
 void Image::drawDebugAllCascades() {
 
-	faceCascade.generateDebugAllCascades(grayscale);
-	eyeCascade.generateDebugAllCascades(grayscale);
-	animeFaceCascade.generateDebugAllCascades(grayscale);
-	animeEyeCascade.generateDebugAllCascades(grayscale);
+	if (!debugDrawing || !checkForGrayscale) return; // generateAll() builds grayscale for it, even when the rects were cached
+
+	// Every cascade scans at 1.1 here : One pyramid for all four
+	Cascade::detectShared(grayscale, { &faceCascade, &eyeCascade, &animeFaceCascade, &animeEyeCascade }, true);
 
 	drawRectList(debugImage, faceCascade.debugRects, faceCascade.color);
 	drawRectList(debugImage, eyeCascade.debugRects, eyeCascade.color);
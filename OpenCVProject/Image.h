@@ -1,14 +1,28 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <random>
 
 #include "Cascade.h"
+#include "StageTimings.h"
+#include "DetectionCache.h"
+#include "OverlayCompositor.h"
 
 #pragma once
 
 using namespace std;
 using namespace cv;
 
+// Which cascade pairs generateCascades() runs
+enum DetectionPolicy {
+    DETECT_BOTH,            // Real and anime pairs always
+    DETECT_REAL_FIRST,      // Anime pair only if the real pair found no face with two eyes
+    DETECT_ANIME_FIRST,     // Real pair only if the anime pair found no face with two eyes
+    DETECT_AUTO             // REAL_FIRST or ANIME_FIRST picked by looksAnime()
+};
+
+class FaceTracker;
+
 class Image {
 
 private:
@@ -20,11 +34,14 @@ private:
 public:
     string path, name, ext;
     Size size;
-    Mat original, normalized, grayscale, faceImage, profileImage, debugImage;
+    Mat original, normalized, grayscale, faceImage, profileImage, debugImage; // faceImage : Output frame (normalized's pixels, released from normalized once a face is drawn)
     Cascade faceCascade = Cascade(frontalFaceCascadePath);
     Cascade eyeCascade = Cascade(eyeCascadePath);
     Cascade animeFaceCascade = Cascade(animeFaceCascadePath);
     Cascade animeEyeCascade = Cascade(animeEyeCascadePath);
+    mt19937 rng;    // Per image so concurrent Images never share rand() state
+    uint64_t detectionCacheKey = 0; // Key of the current image's rects (set by loadCachedCascades)
+    OverlayCompositor overlay;      // drawFace() layer : Its buffers are reused by every image
 
 public:
     bool checkForOriginal = false;
@@ -34,16 +51,49 @@ public:
     bool checkForFaceImage = false;
     bool checkForProfileImage = false;
     bool checkForDebugImage = false;
+
+public:
+    static bool reducedDecode;          // Decode JPEGs at 1/2, 1/4 or 1/8 scale when that still covers size
+    static DetectionCache* detectionCache;  // Rects of earlier runs, keyed by normalized pixels + detection settings : nullptr = always detect
+
+    static Mat mustacheOverlay;         // Premultiplied BGRA (OverlayCompositor::loadAsset) drawn over the mouth instead of the mustache ellipse : Empty = ellipse
+
+    // Render Settings :
+    bool debugDrawing = true;           // Keep a debugImage copy and draw cascades / face guides onto it
+
+    // Detection Settings :
+    bool faceRegionEyes = false;        // Run eye cascades only inside the upper part of each face rect
+    double eyeRegionHeight = 0.6;       // Part of a real face searched for eyes (from the top)
+    double animeEyeRegionHeight = 0.75; // Part of an anime face searched for eyes (from the top)
+    bool parallelCascades = false;      // Run the real and anime cascades as concurrent tasks
+    DetectionPolicy detectionPolicy = DETECT_BOTH;
+    double animeFlatness = 0.55;        // DETECT_AUTO : Share of flat pixels above which anime runs first
+
+    // Detection Stats :
+    int cascadeRuns = 0;
+    int skippedCascades = 0;
+    bool cachedCascades = false;        // Rects came from detectionCache (no cascade ran)
+
+    // Stage times of the current image (reset by loadImage, write is timed by the caller)
+    ImageTimings timings;
     
 public:
-    // Constructor
+    // Constructors
+    Image();
     Image(string _path);
     void loadImage(string _path);
+    void loadFrame(const Mat& frame, string videoPath);
+    uint64_t settingsKey();
 
     void generateAll();
     void generateNormalizedImage();
     void generateGrayscaleImage();
     void generateCascades();
+    bool loadCachedCascades();
+    void storeCachedCascades();
+    bool trackCascades(FaceTracker& tracker);
+    vector<vector<Rect>> cascadeRects() const;
+    bool setCascadeRects(vector<vector<Rect>>&& rects);
     void generateFaceImage();
     //void generateProfileImage(); TODO
 
@@ -51,12 +101,22 @@ public:
     void drawDebugAllCascades();
 
 private:
+    void resetImage(string _path);
 
     vector<Rect> runFaceCascade();
     vector<Rect> runEyeCascade();
     vector<Rect> runAnimeFaceCascade();
     vector<Rect> runAnimeEyeCascade();
 
+    int runFaceEyePair(Cascade& face, Cascade& eye, double eyeRegionHeight);
+    bool pairFound(Cascade& face, Cascade& eye);
+    bool looksAnime();
+    string detectionSettings();
+    uint64_t detectionKey();
+
+    int decodeReduction(const string& path);
+    static bool readJpegSize(const string& path, Size& fileSize);
+
     int eyesInLargestFace(vector<Rect>& faceRects, vector<Rect>& eyeRects, Rect& largestFace);
 
     void drawFace(Rect face, Rect eyeL, Rect eyeR);
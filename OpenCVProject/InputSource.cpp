@@ -0,0 +1,80 @@
+#include <iostream>
+#include <string>
+#include <filesystem>
+#include <algorithm>
+
+#include "InputSource.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+InputSource::InputSource(const string& path, bool _recursive, Filter _skip) : root(path), recursive(_recursive), skip(_skip) {
+	error_code error;
+	if (fs::is_regular_file(root, error)) {
+		single = true;
+		valid = true;
+	}
+	else if (fs::is_directory(root, error)) {
+		walk = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, error);
+		valid = !error;
+		if (error) walkError = error.message();
+	}
+}
+
+// Next valid image path : False once the input is exhausted
+bool InputSource::next(string& path) {
+	if (!valid || finished) return false;
+
+	if (single) {
+		finished = true;
+		fs::directory_entry entry(root);
+		if (!accept(entry)) return false;
+		path = entry.path().string();
+		return true;
+	}
+
+	error_code error;
+	while (walk != fs::recursive_directory_iterator()) {
+		fs::directory_entry entry = *walk;
+		if (!recursive) walk.disable_recursion_pending(); // Sub folders are listed but not entered
+		walk.increment(error);
+		if (error) {
+			walkError = error.message();
+			walk = fs::recursive_directory_iterator(); // Iterator is unusable after a failed increment
+		}
+
+		if (accept(entry)) {
+			path = entry.path().string();
+			return true;
+		}
+	}
+	finished = true;
+	return false;
+}
+
+// Count entry and decide if it is handed out : Extension first (no filesystem access), then the filter
+bool InputSource::accept(const fs::directory_entry& entry) {
+	error_code error;
+	if (entry.is_directory(error)) return false;
+	sourceCounts.listed++;
+
+	if (!validExtension(entry.path().string())) {
+		sourceCounts.invalid++;
+		return false;
+	}
+	if (skip && skip(entry)) {
+		sourceCounts.skipped++;
+		return false;
+	}
+	sourceCounts.valid++;
+	return true;
+}
+
+// Image extension (.png, .jpg, .jpeg) in any case : The path itself keeps its case (case sensitive filesystems)
+bool InputSource::validExtension(const string& path) {
+	size_t extIndex = path.rfind(".");
+	if (extIndex == string::npos || path.find_first_of("\\/", extIndex) != string::npos) return false;
+	string ext = path.substr(extIndex);
+	transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".png" || ext == ".jpg" || ext == ".jpeg";
+}
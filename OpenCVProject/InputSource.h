@@ -0,0 +1,49 @@
+#include <iostream>
+#include <string>
+#include <filesystem>
+#include <functional>
+
+#pragma once
+
+using namespace std;
+
+/// <summary>
+/// Lazy walk over an input file or directory : next() validates one directory entry at a time and hands out the next image path,
+/// so generation starts on the first image found and nothing grows with the size of the directory.
+/// Directories are entered only when recursive, unreadable ones are skipped. Not thread safe : One consumer calls next().
+/// </summary>
+class InputSource {
+public:
+    using Filter = function<bool(const filesystem::directory_entry&)>;     // True = Skip this image (index, duplicates)
+
+    struct Counts {
+        size_t listed = 0;          // Files seen (directories are not counted)
+        size_t invalid = 0;         // Not an image extension
+        size_t skipped = 0;         // Rejected by the filter
+        size_t valid = 0;           // Handed out by next()
+    };
+
+private:
+    filesystem::path root;
+    bool recursive = false;
+    bool single = false;            // root is a file
+    bool valid = false;             // root exists
+    bool finished = false;
+    filesystem::recursive_directory_iterator walk;
+    Filter skip;
+    Counts sourceCounts;
+    string walkError;               // Why the walk stopped early (empty = it did not)
+
+    bool accept(const filesystem::directory_entry& entry);
+
+public:
+    InputSource(const string& path, bool recursive = false, Filter skip = nullptr);
+
+    bool next(string& path);
+    bool isValid() const { return valid; }
+    bool isDirectory() const { return valid && !single; }
+    const Counts& counts() const { return sourceCounts; }
+    const string& error() const { return walkError; }
+
+    static bool validExtension(const string& path);
+};
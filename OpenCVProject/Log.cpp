@@ -1,46 +1,57 @@
 #include <iostream>
 #include <string>
 #include <sstream>
-#include <map>
 #include <stack>
 #include <iterator>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
 #include "Log.h"
 
 using namespace std;
 
 // ------------------------------ Static Variables ------------------------------ //
-map<string, bool> Log::idMap{ {"DEFAULT", false} };
+atomic<uint64_t> Log::enabledChannels(~(uint64_t)0);	// Everything whitelisted until logSettings()
 bool Log::headless = false;
 int Log::priorityLevel = 0;
-stack<string> Log::keyStack;
+thread_local stack<LogChannel> Log::keyStack;
+thread_local bool Log::capturing = false;
+thread_local string Log::captureBuffer;
+bool Log::async = true;
+mutex Log::outputMutex;
+atomic<Log::Message*> Log::queueHead(new Log::Message());	// Stub node : Queue is empty while head == tail
+Log::Message* Log::queueTail = Log::queueHead.load();
+atomic<long long> Log::pending(0);
+atomic<unsigned> Log::wakeups(0);
+atomic<bool> Log::stopping(false);
+once_flag Log::writerStarted;
+thread Log::writer;
 /// <summary>
 /// Log::stream << "Message" << Log::print_stream() || endlog;
 /// </summary>
-stringstream Log::stream;
+thread_local stringstream Log::stream;
+thread_local LogChannel Log::streamChannel = LOG_CHANNEL_COUNT;
 
 // ------------------------------- "Streaming" --------------------------------- //
 string Log::printStream() {
-	if (headless) return ""; // If headless, cout will never be called
-	string key = (keyStack.empty()) ? "DEFAULT" : keyStack.top(); // Handle edge case where keyStack is empty
-	if (!idMap.at(key)) {
-		cout << stream.str();
+	bool print = (streamChannel == LOG_CHANNEL_COUNT) ? active() : enabled(streamChannel);
+	if (print) {
+		output(stream.str());
 	}
 	stream.str("");	// Clear sstream
+	streamChannel = LOG_CHANNEL_COUNT;
 	return "";		// Return padder value so function can be called inline
 }
 
 // --------------------------------- Printing ----------------------------------- //
 /// <summary>
 /// Print(message) if key is whitelisted.
-/// If no key scope has been specified "DEFAULT" will be used.
+/// If no key scope has been specified LOG_DEFAULT will be used.
 /// </summary>
 /// <param name="message"> Message to write </param>
-void Log::print(string message) {
-	if (headless) return;
-	string key = (keyStack.empty()) ? "DEFAULT" : keyStack.top();
-	if (!idMap.at(key)) {
-		cout << message;
-	}
+void Log::print(const string& message) {
+	if (active()) output(message);
 }
 /// <summary>
 /// Print(message) with specific ID valid.
@@ -49,24 +60,16 @@ void Log::print(string message) {
 /// </summary>
 /// <param name="key"></param>
 /// <param name="message"></param>
-void Log::print(string message, string key) {
-	if (headless) return;
-	idMap.try_emplace(key, false);
-	if (!idMap.at(key)) {
-		cout << message;
-	}
+void Log::print(const string& message, LogChannel key) {
+	if (enabled(key)) output(message);
 }
 /// <summary>
 /// Println(message) if key is whitelisted
-/// If no key scope has been specified "DEFAULT" will be used.
+/// If no key scope has been specified LOG_DEFAULT will be used.
 /// </summary>
 /// <param name="message"></param>
-void Log::println(string message) {				
-	if (headless) return;
-	string key = (keyStack.empty()) ? "DEFAULT" : keyStack.top();
-	if (!idMap.at(key)) {
-		cout << message << endl;
-	}
+void Log::println(const string& message) {
+	if (active()) output(message + "\n");
 }
 /// <summary>
 /// Println(message) with specific ID valid.
@@ -75,14 +78,125 @@ void Log::println(string message) {
 /// </summary>
 /// <param name="key"></param>
 /// <param name="message"></param>
-void Log::println(string message, string key) {
-	if (headless) return;
-	idMap.try_emplace(key, false);
-	if (!idMap.at(key)) {
-		cout << message << endl;
+void Log::println(const string& message, LogChannel key) {
+	if (enabled(key)) output(message + "\n");
+}
+
+
+// -------------------------------- Capturing ----------------------------------- //
+/// <summary>
+/// Collect everything this thread logs until endCapture() instead of printing it.
+/// Used by batch workers so each image's log can be written in input order.
+/// </summary>
+void Log::beginCapture() {
+	capturing = true;
+	captureBuffer.clear();
+}
+string Log::endCapture() {
+	capturing = false;
+	string captured;
+	captured.swap(captureBuffer);
+	return captured;
+}
+// Write already filtered (captured) output
+void Log::write(const string& captured) {
+	if (headless || captured.empty()) return;
+	output(captured);
+}
+
+void Log::output(const string& message) {
+	if (capturing) {
+		captureBuffer += message;
+		return;
 	}
+	if (async && !stopping) {
+		enqueue(message);
+		return;
+	}
+	lock_guard<mutex> lock(outputMutex);
+	cout << message;
 }
 
+// ------------------------------- Async Output --------------------------------- //
+// Lock-free push : Swap in as the new head, then link the old head to it
+void Log::enqueue(const string& message) {
+	call_once(writerStarted, []() {
+		writer = thread(writerLoop);
+		atexit(stop);	// Anything still queued is written before the process exits
+	});
+
+	Message* node = new Message();
+	node->text = message;
+
+	// Counted before it is linked : drain() can only subtract nodes already counted, so pending never drops below 0
+	// (the writer spins on "pending but not linked yet" until the link below lands)
+	bool wake = pending.fetch_add(1, memory_order_acq_rel) == 0;
+	Message* previous = queueHead.exchange(node, memory_order_acq_rel);
+	previous->next.store(node, memory_order_release);
+
+	if (wake) {
+		wakeups.fetch_add(1, memory_order_acq_rel);
+		wakeups.notify_one();
+	}
+}
+
+// Only thread that touches queueTail or cout (while async) : Exits once stopping and everything queued is written
+void Log::writerLoop() {
+	while (true) {
+		unsigned seen = wakeups.load(memory_order_acquire);
+		if (drain()) continue;
+		if (pending.load(memory_order_acquire) > 0) {
+			this_thread::yield();	// A producer has swapped the head but not linked it yet
+			continue;
+		}
+		if (stopping) return;
+		wakeups.wait(seen, memory_order_acquire);
+	}
+}
+
+// Write every linked message in one batch : Number written
+long long Log::drain() {
+	long long written = 0;
+	string batch;
+	while (true) {
+		Message* next = queueTail->next.load(memory_order_acquire);
+		if (!next) break;
+		batch += next->text;
+		delete queueTail;
+		queueTail = next;
+		written++;
+	}
+	if (!written) return 0;
+	cout << batch;
+	cout.flush();
+	pending.fetch_sub(written, memory_order_acq_rel);
+	pending.notify_all();	// Wake flush()
+	return written;
+}
+
+/// <summary>
+/// Block until everything logged so far has been written.
+/// Call before anything that needs the console in order (ex: waiting on a key press).
+/// </summary>
+void Log::flush() {
+	long long remaining;
+	while ((remaining = pending.load(memory_order_acquire)) != 0) {
+		pending.wait(remaining, memory_order_acquire);
+	}
+}
+
+// Drain and join the writer : Later output is written on the calling thread
+void Log::stop() {
+	if (!writer.joinable()) return;
+	stopping = true;
+	wakeups.fetch_add(1, memory_order_acq_rel);	// Wake the writer so it sees stopping (pending is left alone)
+	wakeups.notify_one();
+	writer.join();
+	// Messages from producers that saw stopping == false just before it was set :
+	while (pending.load(memory_order_acquire) > 0) {
+		if (!drain()) this_thread::yield();
+	}
+}
 
 // -------------------------------- ID Managing --------------------------------- //
 /// <summary> 
@@ -90,9 +204,8 @@ void Log::println(string message, string key) {
 /// Structured as a stack to easily create blacklist scope in a specific function.
 /// </summary>
 /// <param name="key">key/id : Functions as Blacklist Target </param>
-void Log::pushKey(string key) {
+void Log::pushKey(LogChannel key) {
 	if (headless) return;
-	idMap.try_emplace(key, false);	// Try to Add Key To Key Map (Default of whitelisted)
 	keyStack.push(key);
 }
 void Log::popKey() {
@@ -100,24 +213,30 @@ void Log::popKey() {
 	if(!keyStack.empty()) keyStack.pop();
 }
 
-void Log::blacklist(string key) {
-	if (headless) return;
-	idMap.try_emplace(key, true);	// Emplace if key not in map
-	idMap.at(key) = true;			// Set Value
+void Log::blacklist(LogChannel key) {
+	enabledChannels.fetch_and(~((uint64_t)1 << key));
 }
 
-void Log::whitelist(string key) {
-	if (headless) return;
-	idMap.try_emplace(key, false);	// Emplace if key not in map
-	idMap.at(key) = false;			// Set Value
+void Log::whitelist(LogChannel key) {
+	enabledChannels.fetch_or((uint64_t)1 << key);
+}
+
+const char* Log::channelName(LogChannel key) {
+	static const char* names[] = {
+		"DEFAULT", "ERROR", "TITLE", "VALIDATE_INPUT", "INPUT_LIST", "OUTPUT_LIST", "GENERATE", "GENERATE_TITLE",
+		"GENERATE_INFO", "CASCADE", "FACE", "DRAW_FACE", "RESULT", "PIPELINE", "DETECTION", "MEMORY", "TIMING", "SUMMARY"
+	};
+	static_assert(sizeof(names) / sizeof(names[0]) == LOG_CHANNEL_COUNT, "Name every LogChannel");
+	return (key >= 0 && key < LOG_CHANNEL_COUNT) ? names[key] : "UNKNOWN";
 }
 
 // -------------------------------- Debugging ----------------------------------- //
 
 void Log::printIds() {
+	flush();
 	int count = 0;
-	for (auto& x : idMap) {
-		cout << "[" << x.first << ':' << x.second << ']';
+	for (int key = 0; key < LOG_CHANNEL_COUNT; key++) {
+		cout << "[" << channelName((LogChannel)key) << ':' << !enabled((LogChannel)key) << ']';
 		if (++count % 4 == 0) {
 			cout << '\n';
 		}
@@ -128,7 +247,7 @@ void Log::printIds() {
 void Log::printEmptyStack() {
 	while (!keyStack.empty())
 	{
-		cout << ' ' << keyStack.top();
+		cout << ' ' << channelName(keyStack.top());
 		keyStack.pop();
 	}
 }
\ No newline at end of file
@@ -1,48 +1,143 @@
 #include <iostream>
 #include <string>
-#include <map>
 #include <sstream>
 #include <stack>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdint>
 
 #pragma once
 
 using namespace std;
 
+// Log channels (keys) : Checked as bits, so a disabled channel costs one test
+enum LogChannel {
+	LOG_DEFAULT,
+	LOG_ERROR,
+	LOG_TITLE,
+	LOG_VALIDATE_INPUT,
+	LOG_INPUT_LIST,
+	LOG_OUTPUT_LIST,
+	LOG_GENERATE,
+	LOG_GENERATE_TITLE,
+	LOG_GENERATE_INFO,
+	LOG_CASCADE,
+	LOG_FACE,
+	LOG_DRAW_FACE,
+	LOG_RESULT,
+	LOG_PIPELINE,
+	LOG_DETECTION,
+	LOG_MEMORY,
+	LOG_TIMING,
+	LOG_SUMMARY,
+	LOG_CHANNEL_COUNT
+};
+static_assert(LOG_CHANNEL_COUNT <= 64, "LogChannel bits must fit in a uint64_t");
+
+// Build option : Channels in this mask are compiled out (ex: /D LOG_DISABLED_CHANNELS=0x700 drops GENERATE_INFO, CASCADE, FACE)
+#ifndef LOG_DISABLED_CHANNELS
+#define LOG_DISABLED_CHANNELS 0
+#endif
+
+// startlog << ... << endlog : Formats only if the current key is enabled
+// logto(channel) << ... << endlog : Same for a fixed channel (printStream() filters on it, not the key stack), compiled out entirely when channel is in LOG_DISABLED_CHANNELS
+#define startlog if (!Log::active()) {} else Log::streamTo(LOG_CHANNEL_COUNT)
+#define logto(channel) if (!Log::enabled(channel)) {} else Log::streamTo(channel)
+
 /// <summary>
 /// stream < ... < printStream()
+/// stream and key scopes are per thread : beginCapture()/endCapture() collect a thread's output so it can be written later in order
+/// Output is pushed onto a lock-free queue and written to cout by one writer thread, so logging never waits on the console
+/// Keys are LogChannel ids : blacklist()/whitelist() flip bits in enabledChannels, no strings or map lookups on the hot path
 /// </summary>
 class Log {
 public:
-	static map<string, bool> idMap;		// Key, if_blacklisted
+	static constexpr uint64_t compiledChannels = ~(uint64_t)(LOG_DISABLED_CHANNELS);
+	static atomic<uint64_t> enabledChannels;	// Bit per LogChannel : Set = whitelisted
 	static bool headless;				// Print Off//On Switch
-	static stringstream stream;
+	static thread_local stringstream stream;
+	static thread_local LogChannel streamChannel;	// Channel of the message being formatted : LOG_CHANNEL_COUNT = Current key
 
 	static int priorityLevel;			// TODO ????
+	static bool async;					// Hand output to the writer thread (false = write to cout on the calling thread)
 
 private:
-	static string defaultKey;			// Default ID
-	static stack<string> keyStack;		// Keeps track of keys
+	static thread_local stack<LogChannel> keyStack;	// Keeps track of keys
+	static thread_local bool capturing;				// Output goes to captureBuffer instead of cout
+	static thread_local string captureBuffer;
+	static mutex outputMutex;			// Keeps concurrent cout writes whole (sync output only)
+
+	// Async Output : Intrusive MPSC queue (producers swap queueHead, the writer owns queueTail)
+	struct Message {
+		string text;
+		atomic<Message*> next = nullptr;
+	};
+	static atomic<Message*> queueHead;
+	static Message* queueTail;
+	static atomic<long long> pending;	// Pushed but not yet written : flush() waits on it
+	static atomic<unsigned> wakeups;	// Bumped by enqueue() and stop() : The writer sleeps on it
+	static atomic<bool> stopping;
+	static once_flag writerStarted;
+	static thread writer;
 
 public:
 
 	// Set Local Key:
-	static void pushKey(string key);
+	static void pushKey(LogChannel key);
 	static void popKey();
 
+	// Key Checks:
+	static bool enabled(LogChannel key) {
+		return ((compiledChannels >> key) & 1) && !headless && ((enabledChannels.load(memory_order_relaxed) >> key) & 1);
+	}
+	static bool active() {
+		return enabled(keyStack.empty() ? LOG_DEFAULT : keyStack.top());
+	}
+
 	// Key Based Printing:
+	static stringstream& streamTo(LogChannel channel) {
+		streamChannel = channel;
+		return stream;
+	}
 	static string printStream();
-	static void print(string message);
-	static void print(string message, string key);
-	static void println(string message);
-	static void println(string message, string key);
+	static void print(const string& message);
+	static void print(const string& message, LogChannel key);
+	static void println(const string& message);
+	static void println(const string& message, LogChannel key);
+
 
+	// Capturing:
+	static void beginCapture();
+	static string endCapture();
+	static void write(const string& captured);
+
+	// Async Output:
+	static void flush();
+	static void stop();
 
 	// Print Toggles:
-	static void blacklist(string key);
-	static void whitelist(string key);
+	static void blacklist(LogChannel key);
+	static void whitelist(LogChannel key);
+	static const char* channelName(LogChannel key);
 
 	// Debugging Stuff:
 	static void printIds();
 	static void printEmptyStack();
+
+private:
+	static void output(const string& message);
+	static void enqueue(const string& message);
+	static void writerLoop();
+	static long long drain();
 };
 
+
+// Pushes key until it goes out of scope : Popped on exceptions too
+class LogKey {
+public:
+	LogKey(LogChannel key) { Log::pushKey(key); }
+	~LogKey() { Log::popKey(); }
+	LogKey(const LogKey&) = delete;
+	LogKey& operator=(const LogKey&) = delete;
+};
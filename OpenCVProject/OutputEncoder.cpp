@@ -0,0 +1,89 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#include "OutputEncoder.h"
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+OutputEncoder::OutputEncoder(Format _format, int _quality, int _pngCompression)
+	: format(_format), quality(clamp(_quality, 1, 100)), pngCompression(clamp(_pngCompression, 0, 9)) {
+}
+
+OutputEncoder& OutputEncoder::operator=(const OutputEncoder& other) {
+	format = other.format;
+	quality = other.quality;
+	pngCompression = other.pngCompression;
+	return *this;
+}
+
+// "" / keep = Input format : jpg / jpeg / png / webp (any case)
+bool OutputEncoder::parseFormat(const string& name, Format& format) {
+	string lower = name;
+	transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	if (!lower.empty() && lower[0] == '.') lower.erase(0, 1);
+	if (lower.empty() || lower == "keep") format = FORMAT_KEEP;
+	else if (lower == "jpg" || lower == "jpeg") format = FORMAT_JPEG;
+	else if (lower == "png") format = FORMAT_PNG;
+	else if (lower == "webp") format = FORMAT_WEBP;
+	else return false;
+	return true;
+}
+
+// Extension results are stored with : The input's own when the format is kept
+string OutputEncoder::extension(const string& inputExtension) const {
+	switch (format) {
+	case FORMAT_JPEG: return ".jpg";
+	case FORMAT_PNG: return ".png";
+	case FORMAT_WEBP: return ".webp";
+	default: return inputExtension;
+	}
+}
+
+// imencode() flags for extension : Only the ones the extension's encoder reads
+vector<int> OutputEncoder::parameters(const string& extension) const {
+	string lower = extension;
+	transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	if (lower == ".jpg" || lower == ".jpeg") return { IMWRITE_JPEG_QUALITY, quality };
+	if (lower == ".webp") return { IMWRITE_WEBP_QUALITY, quality };
+	if (lower == ".png") return { IMWRITE_PNG_COMPRESSION, pngCompression };
+	return {};
+}
+
+/// <summary>
+/// Encode image in the format of path's extension, write it to a temporary file then rename it over path.
+/// </summary>
+/// <returns> False if encoding or writing failed : path is left as it was </returns>
+bool OutputEncoder::write(const string& path, const Mat& image) const {
+	string ext = fs::path(path).extension().string();
+	vector<uchar> encoded;
+	if (image.empty() || !imencode(ext, image, encoded, parameters(ext))) return false;
+
+	// Counter in the name : Two threads writing the same target never share a temporary file
+	string tempPath = path + "." + to_string(tempCount++) + ".tmp";
+	{
+		ofstream file(tempPath, ios::binary | ios::trunc);
+		if (!file) return false;
+		file.write((const char*)encoded.data(), (streamsize)encoded.size());
+		if (!file.flush()) {
+			file.close();
+			error_code error;
+			fs::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	error_code error;
+	fs::rename(tempPath, path, error);
+	if (error) {
+		fs::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,38 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <atomic>
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+/// <summary>
+/// How results are stored : Format override (or the input's own format), JPEG / WebP quality and PNG compression level.
+/// write() encodes in memory and writes a temporary file next to the target, then renames it over the target :
+/// An interrupted run never leaves a half written image that a later run would count as done.
+/// Immutable once configured, so any number of encode threads can share one.
+/// </summary>
+class OutputEncoder {
+public:
+    enum Format { FORMAT_KEEP, FORMAT_JPEG, FORMAT_PNG, FORMAT_WEBP };
+
+private:
+    Format format = FORMAT_KEEP;
+    int quality = 95;               // JPEG / WebP : 1 - 100
+    int pngCompression = 1;         // PNG : 0 - 9 (zlib level) : Low levels are several times faster for a slightly larger file
+    mutable atomic<unsigned> tempCount = 0;
+
+public:
+    OutputEncoder() = default;
+    OutputEncoder(Format _format, int _quality, int _pngCompression);
+    OutputEncoder& operator=(const OutputEncoder& other);
+
+    static bool parseFormat(const string& name, Format& format);
+
+    string extension(const string& inputExtension) const;
+    vector<int> parameters(const string& extension) const;
+    bool write(const string& path, const Mat& image) const;
+};
@@ -0,0 +1,195 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <cstring>
+
+#include "OverlayCompositor.h"
+
+// x86 only : Other targets always blend with the scalar loop
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define OVERLAY_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define OVERLAY_TARGET(isa)
+#else
+#define OVERLAY_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+using namespace std;
+using namespace cv;
+
+CompiledCascade::SimdLevel OverlayCompositor::simd = CompiledCascade::detectSimd();
+
+// Exact round(x / 255) for x <= 255 * 255
+static inline int div255(int x) {
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+// -------------------------------- Layer --------------------------------- //
+// Clear a transparent layer over bounds (clipped to the frame) : Drawing outside it is cut off
+void OverlayCompositor::begin(Rect bounds, Size frameSize) {
+	region = bounds & Rect(Point(0, 0), frameSize);
+	if (region.empty()) {
+		layer.release();
+		return;
+	}
+	layer.create(region.size(), CV_8UC4);
+	layer.setTo(Scalar::all(0));
+}
+
+// Opaque primitives : Their anti-aliased edges are the only partly transparent pixels
+void OverlayCompositor::drawEllipse(const RotatedRect& bounds, const Scalar& color, int thickness) {
+	if (layer.empty()) return;
+	RotatedRect local(bounds.center - Point2f((float)region.x, (float)region.y), bounds.size, bounds.angle);
+	ellipse(layer, local, Scalar(color[0], color[1], color[2], 255), thickness, LINE_AA);
+}
+
+void OverlayCompositor::drawCircle(Point center, int radius, const Scalar& color, int thickness) {
+	if (layer.empty() || radius <= 0) return;
+	circle(layer, center - region.tl(), radius, Scalar(color[0], color[1], color[2], 255), thickness, LINE_AA);
+}
+
+/// <summary>
+/// Stretch a premultiplied BGRA asset (see loadAsset()) onto target : Its top edge follows the rect's top edge, rotation included.
+/// Blended over what the layer already holds, so later primitives still draw on top of it.
+/// </summary>
+void OverlayCompositor::drawImage(const Mat& asset, const RotatedRect& target) {
+	if (layer.empty() || asset.empty() || asset.type() != CV_8UC4) return;
+
+	Point2f corners[4]; // Bottom left, top left, top right, bottom right
+	target.points(corners);
+	Point2f origin((float)region.x, (float)region.y);
+	Point2f from[3] = { Point2f(0, (float)asset.rows), Point2f(0, 0), Point2f((float)asset.cols, 0) };
+	Point2f to[3] = { corners[0] - origin, corners[1] - origin, corners[2] - origin };
+
+	warpAffine(asset, scratch, getAffineTransform(from, to), layer.size(), INTER_LINEAR, BORDER_CONSTANT, Scalar::all(0));
+	blend(scratch, layer, CompiledCascade::SIMD_NONE); // Once per asset : Not worth a vector path
+}
+
+// Blend the layer onto frame at its region : The only pass over frame pixels
+void OverlayCompositor::composite(Mat& frame) const {
+	if (layer.empty() || (region & Rect(Point(0, 0), frame.size())) != region) return; // Not the frame begin() was given
+	Mat target = frame(region);
+	blend(layer, target, simd);
+}
+
+/// <summary>
+/// Read an overlay bitmap : Any channel count or 16 bit depth is converted to BGRA (no alpha = opaque), then premultiplied.
+/// </summary>
+/// <returns> False if path could not be read </returns>
+bool OverlayCompositor::loadAsset(const string& path, Mat& asset) {
+	Mat image = imread(path, IMREAD_UNCHANGED);
+	if (image.empty()) return false;
+	if (image.depth() == CV_16U) image.convertTo(image, CV_8U, 1.0 / 257);
+	else if (image.depth() != CV_8U) return false;
+
+	if (image.channels() == 1) cvtColor(image, asset, COLOR_GRAY2BGRA);
+	else if (image.channels() == 3) cvtColor(image, asset, COLOR_BGR2BGRA);
+	else asset = image.clone();
+
+	for (int y = 0; y < asset.rows; y++) {
+		uchar* pixel = asset.ptr<uchar>(y);
+		for (int x = 0; x < asset.cols; x++, pixel += 4) {
+			int alpha = pixel[3];
+			for (int c = 0; c < 3; c++) pixel[c] = (uchar)div255(pixel[c] * alpha);
+		}
+	}
+	return true;
+}
+
+// -------------------------------- Blending --------------------------------- //
+#ifdef OVERLAY_X86
+// 4 pixels : BGRA source over BGR target, 16 bytes of target readable from target
+OVERLAY_TARGET("sse4.1")
+static inline void blend4(const uchar* source, uchar* target) {
+	const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i compress = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	const __m128i broadcast = _mm_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+	const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(128);
+
+	__m128i src = _mm_loadu_si128((const __m128i*)source);
+	if (_mm_testz_si128(src, alphaMask)) return; // Transparent (premultiplied : color is 0 too)
+
+	__m128i dst = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)target), expand);
+	__m128i inverse = _mm_xor_si128(_mm_shuffle_epi8(src, broadcast), _mm_set1_epi8(-1)); // 255 - alpha
+
+	__m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(inverse, zero)), round);
+	__m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(inverse, zero)), round);
+	low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+	high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+
+	__m128i result = _mm_shuffle_epi8(_mm_adds_epu8(_mm_packus_epi16(low, high), src), compress);
+	_mm_storel_epi64((__m128i*)target, result);
+	int tail = _mm_extract_epi32(result, 2);
+	memcpy(target + 8, &tail, 4);
+}
+
+// 8 pixels : Same as blend4() per 128 bit lane, 28 bytes of target readable from target
+OVERLAY_TARGET("avx2")
+static inline void blend8(const uchar* source, uchar* target) {
+	const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m256i compress = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	const __m256i broadcast = _mm256_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15, 3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+	const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i round = _mm256_set1_epi16(128);
+
+	__m256i src = _mm256_loadu_si256((const __m256i*)source);
+	if (_mm256_testz_si256(src, alphaMask)) return;
+
+	__m256i dst = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)target)), _mm_loadu_si128((const __m128i*)(target + 12)), 1);
+	dst = _mm256_shuffle_epi8(dst, expand);
+	__m256i inverse = _mm256_xor_si256(_mm256_shuffle_epi8(src, broadcast), _mm256_set1_epi8(-1));
+
+	__m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), _mm256_unpacklo_epi8(inverse, zero)), round);
+	__m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), _mm256_unpackhi_epi8(inverse, zero)), round);
+	low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+	high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+
+	__m256i result = _mm256_shuffle_epi8(_mm256_adds_epu8(_mm256_packus_epi16(low, high), src), compress);
+	__m128i first = _mm256_castsi256_si128(result), second = _mm256_extracti128_si256(result, 1);
+	int tail;
+	_mm_storel_epi64((__m128i*)target, first);
+	tail = _mm_extract_epi32(first, 2);
+	memcpy(target + 8, &tail, 4);
+	_mm_storel_epi64((__m128i*)(target + 12), second);
+	tail = _mm_extract_epi32(second, 2);
+	memcpy(target + 20, &tail, 4);
+}
+#endif
+
+/// <summary>
+/// source (premultiplied BGRA) over target (BGR or BGRA, same size) : BGRA targets blend their alpha the same way, so layers stack.
+/// level picks the vector path for BGR targets : Each row ends with scalar pixels where a vector load would run past the row.
+/// </summary>
+void OverlayCompositor::blend(const Mat& source, Mat& target, CompiledCascade::SimdLevel level) {
+	CV_Assert(source.type() == CV_8UC4 && source.size() == target.size() && (target.type() == CV_8UC3 || target.type() == CV_8UC4));
+	int channels = target.channels();
+
+	for (int y = 0; y < source.rows; y++) {
+		const uchar* src = source.ptr<uchar>(y);
+		uchar* dst = target.ptr<uchar>(y);
+		int x = 0;
+#ifdef OVERLAY_X86
+		if (channels == 3 && level == CompiledCascade::SIMD_AVX2) {
+			for (; x + 10 <= source.cols; x += 8) blend8(src + x * 4, dst + x * 3);
+		}
+		if (channels == 3 && level != CompiledCascade::SIMD_NONE) {
+			for (; x + 6 <= source.cols; x += 4) blend4(src + x * 4, dst + x * 3);
+		}
+#endif
+		for (; x < source.cols; x++) {
+			const uchar* pixel = src + x * 4;
+			int inverse = 255 - pixel[3];
+			if (inverse == 255) continue;
+			uchar* out = dst + x * channels;
+			for (int c = 0; c < channels; c++) {
+				out[c] = (uchar)min(255, pixel[c] + div255(out[c] * inverse));
+			}
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+
+#include "CompiledCascade.h"
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+/// <summary>
+/// Renders an overlay into a small BGRA layer covering only the region it touches, then blends the layer onto the frame in one pass.
+/// The layer holds premultiplied alpha : Anti-aliased primitives drawn onto the transparent layer come out premultiplied by their coverage,
+/// and bitmap assets are premultiplied on load, so every blend is dst = src + dst * (255 - alpha) / 255.
+/// composite() blends 4 (SSE4.1) or 8 (AVX2) pixels at once and skips fully transparent blocks, the scalar path gives identical results.
+/// Buffers are kept between images : One compositor per Image, never shared between threads.
+/// </summary>
+class OverlayCompositor {
+private:
+    Mat layer;                  // Premultiplied BGRA, region sized
+    Mat scratch;                // drawImage() : Asset warped into layer space before it is blended onto the layer
+    Rect region;                // Layer position in the frame
+
+public:
+    static CompiledCascade::SimdLevel simd;     // composite() lanes : Detected once, SIMD_NONE forces the scalar path
+
+    void begin(Rect bounds, Size frameSize);
+    void drawEllipse(const RotatedRect& bounds, const Scalar& color, int thickness);
+    void drawCircle(Point center, int radius, const Scalar& color, int thickness);
+    void drawImage(const Mat& asset, const RotatedRect& target);
+    void composite(Mat& frame) const;
+
+    Rect bounds() const { return region; }
+
+    static bool loadAsset(const string& path, Mat& asset);
+    static void blend(const Mat& source, Mat& target, CompiledCascade::SimdLevel level);
+};
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <unordered_map>
+#include <mutex>
+#include <filesystem>
+#include <cstdint>
+
+#include "ProcessedIndex.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const char* INDEX_HEADER = "# heve index v1 : hash size mtime result path";
+static const string SETTINGS_HEADER = "# settings ";
+
+// -------------------------------- Persistence --------------------------------- //
+/// <summary>
+/// Read the index at path : A missing file is an empty index (first run), a malformed line is skipped.
+/// An index written with other detection settings than _settingsKey (or before they were kept) loses its NEGATIVE entries.
+/// </summary>
+/// <returns> False only if the file exists but could not be read </returns>
+bool ProcessedIndex::load(const string& path, uint64_t _settingsKey) {
+	indexPath = path;
+	settingsKey = _settingsKey;
+	entries.clear();
+	loaded = false;
+	dirty = false;
+
+	error_code error;
+	if (!fs::exists(path, error)) return true;
+
+	ifstream file(path);
+	if (!file) return false;
+	loaded = true;
+
+	uint64_t storedKey = 0;
+	string line;
+	while (getline(file, line)) {
+		if (line.compare(0, SETTINGS_HEADER.size(), SETTINGS_HEADER) == 0) {
+			istringstream(line.substr(SETTINGS_HEADER.size())) >> hex >> storedKey;
+			continue;
+		}
+		if (line.empty() || line[0] == '#') continue;
+		istringstream fields(line);
+		Entry entry;
+		char result;
+		string filePath;
+		if (!(fields >> hex >> entry.hash >> dec >> entry.size >> entry.mtime >> result)) continue;
+		fields.get(); // Single space before the path (paths may contain spaces)
+		getline(fields, filePath);
+		if (filePath.empty() || (result != POSITIVE && result != NEGATIVE && result != FAILED)) continue;
+		entry.result = (Result)result;
+		entries[filePath] = entry;
+	}
+
+	// Settings changed : Inputs without a face are detected again, saved under the new key
+	if (storedKey != settingsKey) {
+		for (auto entry = entries.begin(); entry != entries.end();) {
+			if (entry->second.result == NEGATIVE) entry = entries.erase(entry);
+			else entry++;
+		}
+		dirty = true;
+	}
+	entries.rehash(entries.size() * 2); // Room for this run's new inputs
+	return true;
+}
+
+// Write to a temporary file then rename over the index : A crash mid save keeps the previous index
+bool ProcessedIndex::save() {
+	if (!dirty || indexPath.empty()) return true;
+
+	string tempPath = indexPath + ".tmp";
+	{
+		ofstream file(tempPath, ios::trunc);
+		if (!file) return false;
+		file << INDEX_HEADER << "\n";
+		file << SETTINGS_HEADER << hex << settingsKey << dec << "\n";
+		for (const auto& [filePath, entry] : entries) {
+			file << hex << entry.hash << dec << " " << entry.size << " " << entry.mtime << " " << (char)entry.result << " " << filePath << "\n";
+		}
+		if (!file.flush()) return false;
+	}
+
+	error_code error;
+	fs::rename(tempPath, indexPath, error);
+	if (error) {
+		fs::remove(tempPath, error);
+		return false;
+	}
+	dirty = false;
+	loaded = true;
+	return true;
+}
+
+// ------------------------------- Lookup / Update ------------------------------- //
+/// <summary>
+/// If file was processed before and has not changed since : Size and mtime from the directory entry decide in the common case,
+/// the contents are only hashed when the size matches but the mtime does not. Failed inputs are never skipped.
+/// Called while earlier inputs are still being recorded : The hash is read outside the lock.
+/// </summary>
+bool ProcessedIndex::unchanged(const fs::directory_entry& file) {
+	string path = file.path().string();
+	Entry entry;
+	{
+		lock_guard<mutex> lock(indexMutex);
+		auto found = entries.find(path);
+		if (found == entries.end()) return false;
+		found->second.seen = true;
+		entry = found->second;
+	}
+	if (entry.result == FAILED) return false;
+
+	error_code error;
+	uint64_t size = file.file_size(error);
+	if (error || size != entry.size) return false;
+	int64_t mtime = file.last_write_time(error).time_since_epoch().count();
+	if (error) return false;
+	if (mtime == entry.mtime) return true;
+
+	// Touched : Same bytes keeps the entry (with the new mtime so the next run is back to the fast path)
+	uint64_t hash;
+	if (!hashFile(path, hash) || hash != entry.hash) return false;
+	lock_guard<mutex> lock(indexMutex);
+	auto found = entries.find(path);
+	if (found != entries.end()) found->second.mtime = mtime;
+	dirty = true;
+	return true;
+}
+
+// If path has an entry (of any result) : Its skip was decided by the index, not by output names
+bool ProcessedIndex::contains(const string& path) {
+	lock_guard<mutex> lock(indexMutex);
+	return entries.count(path) > 0;
+}
+
+// Store the outcome of processing path : Must run before the input is deleted (it is read for the hash)
+bool ProcessedIndex::record(const string& path, Result result) {
+	Entry entry;
+	entry.result = result;
+	entry.seen = true;
+
+	error_code error;
+	entry.size = fs::file_size(path, error);
+	if (error) return false;
+	entry.mtime = fs::last_write_time(path, error).time_since_epoch().count();
+	if (error) return false;
+	if (!hashFile(path, entry.hash)) return false;
+
+	lock_guard<mutex> lock(indexMutex);
+	entries[path] = entry;
+	dirty = true;
+	return true;
+}
+
+// Output for path could not be written after record() : Processed again next run
+void ProcessedIndex::fail(const string& path) {
+	lock_guard<mutex> lock(indexMutex);
+	auto found = entries.find(path);
+	if (found == entries.end()) return;
+	found->second.result = FAILED;
+	dirty = true;
+}
+
+/// <summary>
+/// Drop entries for files in directory (and its sub folders when recursive) that this run's scan did not list (deleted or moved inputs).
+/// Entries from other input directories sharing the index are left alone. Only call once the scan has finished.
+/// </summary>
+/// <returns> Number of entries removed </returns>
+size_t ProcessedIndex::prune(const string& directory, bool recursive) {
+	fs::path folder = (fs::path(directory) / "x").parent_path(); // Same form with or without a trailing separator
+	auto inFolder = [&](const fs::path& file) {
+		if (!recursive) return file.parent_path() == folder;
+		fs::path relative = file.lexically_relative(folder);
+		return !relative.empty() && *relative.begin() != "..";
+	};
+	size_t removed = 0;
+	for (auto entry = entries.begin(); entry != entries.end();) {
+		if (!entry->second.seen && inFolder(fs::path(entry->first))) {
+			entry = entries.erase(entry);
+			removed++;
+		}
+		else {
+			entry++;
+		}
+	}
+	if (removed) dirty = true;
+	return removed;
+}
+
+// FNV-1a (64 bit) of the file contents
+bool ProcessedIndex::hashFile(const string& path, uint64_t& hash) {
+	ifstream file(path, ios::binary);
+	if (!file) return false;
+
+	hash = 14695981039346656037ull;
+	char buffer[1 << 16];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+		streamsize count = file.gcount();
+		for (streamsize i = 0; i < count; i++) {
+			hash ^= (unsigned char)buffer[i];
+			hash *= 1099511628211ull;
+		}
+	}
+	return !file.bad();
+}
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <filesystem>
+#include <cstdint>
+
+#pragma once
+
+using namespace std;
+
+/// <summary>
+/// On disk record of every input already processed, keyed by path with its size, mtime and content hash.
+/// unchanged() answers "can this input be skipped" with one hash map lookup against the directory entry's size and mtime,
+/// only reading the file when those differ (a touched but identical file is kept, an edited one is processed again).
+/// unchanged(), contains(), record() and fail() are thread safe (inputs are checked while earlier ones are recorded) : load(), prune() and save() are not.
+/// The index is a text file ("hash size mtime result path" per line) saved atomically at the end of a run.
+/// It also keeps the detection settings key it was written with : When load() is given a different one, NEGATIVE entries are dropped
+/// (a setting change may find faces they missed), POSITIVE ones stay (their output already exists).
+/// </summary>
+class ProcessedIndex {
+public:
+    enum Result : char { POSITIVE = 'P', NEGATIVE = 'N', FAILED = 'F' };
+
+    struct Entry {
+        uint64_t hash = 0;          // FNV-1a of the file contents
+        uint64_t size = 0;
+        int64_t mtime = 0;          // last_write_time ticks
+        Result result = FAILED;
+        bool seen = false;          // Listed by this run's input scan (prune())
+    };
+
+private:
+    unordered_map<string, Entry> entries;
+    mutex indexMutex;               // unchanged() / record() / fail() run on the decode, result and encode threads
+    string indexPath;
+    uint64_t settingsKey = 0;       // Detection settings the results were found with (Image::settingsKey)
+    bool loaded = false;            // File existed when load() ran
+    bool dirty = false;
+
+public:
+    // Persistence :
+    bool load(const string& path, uint64_t settingsKey);
+    bool save();
+    bool existed() const { return loaded; }
+    size_t size() const { return entries.size(); }
+
+    // Lookup / Update :
+    bool unchanged(const filesystem::directory_entry& file);
+    bool contains(const string& path);
+    bool record(const string& path, Result result);
+    void fail(const string& path);
+    size_t prune(const string& directory, bool recursive = false);
+
+    static bool hashFile(const string& path, uint64_t& hash);
+};
@@ -0,0 +1,22 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+
+#include "RunSettings.h"
+#include "BufferPool.h"
+
+using namespace std;
+using namespace cv;
+
+// Process wide settings : Call before any Mat is created (the allocator only applies to later allocations)
+void RunSettings::applyProcess() const {
+	if (pooledBuffers) Mat::setDefaultAllocator(&BufferPool::instance());
+	Image::reducedDecode = reducedDecode;
+}
+
+// Detection settings of one Image : They survive loadImage(), so reused Images only need them once
+void RunSettings::apply(Image& image) const {
+	image.faceRegionEyes = faceRegionEyes;
+	image.parallelCascades = parallelCascades;
+	image.detectionPolicy = detectionPolicy;
+}
@@ -0,0 +1,25 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+
+#include "Image.h"
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+/// <summary>
+/// Decode, memory and detection settings every entry point starts from (main, Benchmark, Sweep) : One set of defaults, so measurements match shipped runs.
+/// main overrides the fields at runtime (settingTable), the tools use them as they are.
+/// </summary>
+struct RunSettings {
+    bool reducedDecode = true;          // Decode large JPEGs at a reduced scale (1/2, 1/4, 1/8) that still covers the 720px target
+    bool pooledBuffers = true;          // Mat buffers come from BufferPool : Reused across images instead of freed
+    bool faceRegionEyes = false;        // Search for eyes only in the upper part of detected faces (skips eyes when no face : Changes results, opt in)
+    bool parallelCascades = false;      // Run an image's cascades concurrently : Lowers single image latency (best with batchWorkers = 1)
+    DetectionPolicy detectionPolicy = DETECT_BOTH; // BOTH : REAL_FIRST / ANIME_FIRST skip the other pair on a match : AUTO picks the order per image (opt in, changes results)
+
+    void applyProcess() const;
+    void apply(Image& image) const;
+};
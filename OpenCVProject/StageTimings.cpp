@@ -0,0 +1,246 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+#include "StageTimings.h"
+#include "Log.h"
+
+#define endlog Log::printStream()
+
+using namespace std;
+using namespace cv;
+
+// ------------------------------- Image Timings --------------------------------- //
+void ImageTimings::reset(const string& _path) {
+	path = _path;
+	size = Size(0, 0);
+	decodeReduction = 1;
+	positive = false;
+	for (long long& stage : microseconds) stage = -1;
+}
+
+// Sum of the stages that ran
+long long ImageTimings::total() const {
+	long long sum = 0;
+	for (long long stage : microseconds) {
+		if (stage > 0) sum += stage;
+	}
+	return sum;
+}
+
+StageTimer::~StageTimer() {
+	long long elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+	target = max(target, 0LL) + elapsed;
+}
+
+// ------------------------------- Report --------------------------------- //
+size_t TimingReport::add(const ImageTimings& timings) {
+	lock_guard<mutex> lock(reportMutex);
+	records.push_back(timings);
+	return records.size() - 1;
+}
+
+void TimingReport::setStage(size_t index, TimingStage stage, long long microseconds) {
+	lock_guard<mutex> lock(reportMutex);
+	if (index < records.size()) records[index].microseconds[stage] = microseconds;
+}
+
+size_t TimingReport::size() const {
+	lock_guard<mutex> lock(reportMutex);
+	return records.size();
+}
+
+StageSummary TimingReport::summarize(TimingStage stage) const {
+	vector<long long> samples;
+	{
+		lock_guard<mutex> lock(reportMutex);
+		for (const ImageTimings& record : records) {
+			if (record.microseconds[stage] >= 0) samples.push_back(record.microseconds[stage]);
+		}
+	}
+	return summarize(move(samples));
+}
+
+StageSummary TimingReport::summarizeTotal() const {
+	vector<long long> samples;
+	{
+		lock_guard<mutex> lock(reportMutex);
+		for (const ImageTimings& record : records) samples.push_back(record.total());
+	}
+	return summarize(move(samples));
+}
+
+// Nearest rank percentiles : p99 of fewer than 100 images is the slowest one
+StageSummary TimingReport::summarize(vector<long long> samples) {
+	StageSummary summary;
+	summary.count = samples.size();
+	if (samples.empty()) return summary;
+
+	sort(samples.begin(), samples.end());
+	auto percentile = [&](double p) {
+		size_t rank = (size_t)ceil(p * samples.size());
+		return samples[min(samples.size(), max<size_t>(rank, 1)) - 1] / 1000.0;
+	};
+	summary.p50 = percentile(0.50);
+	summary.p95 = percentile(0.95);
+	summary.p99 = percentile(0.99);
+	summary.max = samples.back() / 1000.0;
+
+	long long sum = 0;
+	for (long long sample : samples) sum += sample;
+	summary.mean = (double)sum / samples.size() / 1000.0;
+	return summary;
+}
+
+// Stage keys used by the JSON / CSV reports
+const char* TimingReport::stageName(TimingStage stage) {
+	static const char* names[] = {
+		"decode", "normalize", "grayscale", "face_cascade", "eye_cascade", "anime_face_cascade", "anime_eye_cascade", "track", "face_image", "write"
+	};
+	static_assert(sizeof(names) / sizeof(names[0]) == STAGE_COUNT, "Name every TimingStage");
+	return (stage >= 0 && stage < STAGE_COUNT) ? names[stage] : "unknown";
+}
+
+// ------------------------------- Output --------------------------------- //
+// JSON string : Windows paths are full of backslashes
+static string jsonString(const string& text) {
+	string quoted = "\"";
+	for (char c : text) {
+		switch (c) {
+		case '"': quoted += "\\\""; break;
+		case '\\': quoted += "\\\\"; break;
+		case '\n': quoted += "\\n"; break;
+		case '\t': quoted += "\\t"; break;
+		default:
+			if ((unsigned char)c < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				quoted += escaped;
+			}
+			else {
+				quoted += c;
+			}
+		}
+	}
+	return quoted + "\"";
+}
+
+// CSV field : Quoted only when it has to be
+static string csvField(const string& text) {
+	if (text.find_first_of(",\"\n") == string::npos) return text;
+	string quoted = "\"";
+	for (char c : text) {
+		quoted += c;
+		if (c == '"') quoted += '"';
+	}
+	return quoted + "\"";
+}
+
+static void writeSummaryJson(ostream& out, const StageSummary& summary) {
+	out << "{ \"count\": " << summary.count << ", \"p50_ms\": " << summary.p50 << ", \"p95_ms\": " << summary.p95
+		<< ", \"p99_ms\": " << summary.p99 << ", \"max_ms\": " << summary.max << ", \"mean_ms\": " << summary.mean << " }";
+}
+
+/// <summary>
+/// { "images", "positives", "summary": { stage: { count, p50_ms, p95_ms, p99_ms, max_ms, mean_ms }, ..., "total" },
+///   "images_detail": [ { path, width, height, decode_reduction, positive, "ms": { stage: ms or null } } ] }
+/// </summary>
+bool TimingReport::writeJson(const string& path) const {
+	ofstream out(path);
+	if (!out) return false;
+	out << fixed << setprecision(3);
+
+	vector<ImageTimings> rows;
+	{
+		lock_guard<mutex> lock(reportMutex);
+		rows = records;
+	}
+	size_t positives = count_if(rows.begin(), rows.end(), [](const ImageTimings& row) { return row.positive; });
+
+	out << "{\n";
+	out << "  \"images\": " << rows.size() << ",\n";
+	out << "  \"positives\": " << positives << ",\n";
+	out << "  \"summary\": {\n";
+	for (int stage = 0; stage < STAGE_COUNT; stage++) {
+		out << "    \"" << stageName((TimingStage)stage) << "\": ";
+		writeSummaryJson(out, summarize((TimingStage)stage));
+		out << ",\n";
+	}
+	out << "    \"total\": ";
+	writeSummaryJson(out, summarizeTotal());
+	out << "\n  },\n";
+
+	out << "  \"images_detail\": [";
+	for (size_t i = 0; i < rows.size(); i++) {
+		const ImageTimings& row = rows[i];
+		out << (i ? ",\n" : "\n") << "    { \"path\": " << jsonString(row.path) << ", \"width\": " << row.size.width << ", \"height\": " << row.size.height
+			<< ", \"decode_reduction\": " << row.decodeReduction << ", \"positive\": " << (row.positive ? "true" : "false") << ", \"ms\": {";
+		for (int stage = 0; stage < STAGE_COUNT; stage++) {
+			out << (stage ? ", \"" : " \"") << stageName((TimingStage)stage) << "\": ";
+			if (row.microseconds[stage] < 0) out << "null";
+			else out << row.microseconds[stage] / 1000.0;
+		}
+		out << ", \"total\": " << row.total() / 1000.0 << " } }";
+	}
+	out << (rows.empty() ? "]\n" : "\n  ]\n");
+	out << "}\n";
+	return (bool)out;
+}
+
+/// <summary>
+/// path : One row per image (stage columns in ms, empty when the stage did not run)
+/// summaryPath : One row per stage (count, p50_ms, p95_ms, p99_ms, max_ms, mean_ms) plus total
+/// </summary>
+bool TimingReport::writeCsv(const string& path, const string& summaryPath) const {
+	vector<ImageTimings> rows;
+	{
+		lock_guard<mutex> lock(reportMutex);
+		rows = records;
+	}
+
+	ofstream out(path);
+	if (!out) return false;
+	out << fixed << setprecision(3);
+	out << "path,width,height,decode_reduction,positive";
+	for (int stage = 0; stage < STAGE_COUNT; stage++) out << "," << stageName((TimingStage)stage) << "_ms";
+	out << ",total_ms\n";
+	for (const ImageTimings& row : rows) {
+		out << csvField(row.path) << "," << row.size.width << "," << row.size.height << "," << row.decodeReduction << "," << (row.positive ? 1 : 0);
+		for (int stage = 0; stage < STAGE_COUNT; stage++) {
+			out << ",";
+			if (row.microseconds[stage] >= 0) out << row.microseconds[stage] / 1000.0;
+		}
+		out << "," << row.total() / 1000.0 << "\n";
+	}
+
+	ofstream summaryOut(summaryPath);
+	if (!summaryOut) return false;
+	summaryOut << fixed << setprecision(3);
+	summaryOut << "stage,count,p50_ms,p95_ms,p99_ms,max_ms,mean_ms\n";
+	for (int stage = 0; stage <= STAGE_COUNT; stage++) {
+		StageSummary summary = (stage == STAGE_COUNT) ? summarizeTotal() : summarize((TimingStage)stage);
+		summaryOut << ((stage == STAGE_COUNT) ? "total" : stageName((TimingStage)stage)) << "," << summary.count << "," << summary.p50 << ","
+			<< summary.p95 << "," << summary.p99 << "," << summary.max << "," << summary.mean << "\n";
+	}
+	return (bool)out && (bool)summaryOut;
+}
+
+// Summary table under the current key
+void TimingReport::log() const {
+	startlog << "Stage Timings : [" << size() << " Images] (ms)" << endl << endlog;
+	startlog << fixed << setprecision(2);
+	for (int stage = 0; stage <= STAGE_COUNT; stage++) {
+		StageSummary summary = (stage == STAGE_COUNT) ? summarizeTotal() : summarize((TimingStage)stage);
+		if (!summary.count) continue;
+		startlog << "[" << ((stage == STAGE_COUNT) ? "total" : stageName((TimingStage)stage)) << "] p50 " << summary.p50 << " : p95 " << summary.p95
+			<< " : p99 " << summary.p99 << " : max " << summary.max << " (" << summary.count << ")" << endl << endlog;
+	}
+	startlog << defaultfloat << setprecision(6);
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+
+#pragma once
+
+using namespace std;
+using namespace cv;
+
+// Timed steps of one image, in pipeline order
+enum TimingStage {
+    STAGE_DECODE,               // imread in loadImage()
+    STAGE_NORMALIZE,            // generateNormalizedImage()
+    STAGE_GRAYSCALE,            // generateGrayscaleImage()
+    STAGE_FACE_CASCADE,         // Each Cascade's detectMultiScale (summed over detectInRegions areas)
+    STAGE_EYE_CASCADE,
+    STAGE_ANIME_FACE_CASCADE,
+    STAGE_ANIME_EYE_CASCADE,
+    STAGE_TRACK,                // Video : FaceTracker::update() on frames between keyframes
+    STAGE_FACE_IMAGE,           // generateFaceImage() (drawFace included)
+    STAGE_WRITE,                // Encode and write of the result
+    STAGE_COUNT
+};
+
+// Stage times of one image : -1 = stage did not run (skipped cascade, nothing written)
+struct ImageTimings {
+    string path;
+    Size size;                  // Decoded frame (before normalization)
+    int decodeReduction = 1;    // JPEG DCT scale the frame was decoded at
+    bool positive = false;
+    long long microseconds[STAGE_COUNT];
+
+    ImageTimings() { reset(""); }
+    void reset(const string& _path);
+    long long total() const;
+};
+
+// Adds the time until it goes out of scope to target (-1 counts as 0)
+class StageTimer {
+private:
+    long long& target;
+    chrono::steady_clock::time_point start;
+
+public:
+    StageTimer(long long& _target) : target(_target), start(chrono::steady_clock::now()) {}
+    ~StageTimer();
+};
+
+// Aggregate of one stage over a run
+struct StageSummary {
+    size_t count = 0;           // Images the stage ran on
+    double p50 = 0, p95 = 0, p99 = 0, max = 0, mean = 0; // Milliseconds
+};
+
+/// <summary>
+/// Per image stage timings for a run : Images are added in input order (add() returns the row),
+/// stages finished later on another thread (ex: pipeline writes) are filled in with setStage().
+/// summarize() gives nearest rank p50 / p95 / p99 / max, writeJson() / writeCsv() dump rows and summaries.
+/// </summary>
+class TimingReport {
+private:
+    mutable mutex reportMutex;
+    vector<ImageTimings> records;
+
+public:
+    size_t add(const ImageTimings& timings);
+    void setStage(size_t index, TimingStage stage, long long microseconds);
+    size_t size() const;
+
+    StageSummary summarize(TimingStage stage) const;
+    StageSummary summarizeTotal() const;
+
+    bool writeJson(const string& path) const;
+    bool writeCsv(const string& path, const string& summaryPath) const;
+    void log() const;
+
+    static const char* stageName(TimingStage stage);
+
+private:
+    static StageSummary summarize(vector<long long> samples);
+};
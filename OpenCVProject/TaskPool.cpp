@@ -0,0 +1,48 @@
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+
+#include "TaskPool.h"
+
+using namespace std;
+
+TaskPool::TaskPool(int threadCount) {
+	for (int i = 0; i < max(1, threadCount); i++) {
+		workers.emplace_back(&TaskPool::workerLoop, this);
+	}
+}
+
+// Finish queued tasks then join
+TaskPool::~TaskPool() {
+	{
+		lock_guard<mutex> lock(poolMutex);
+		stopping = true;
+	}
+	taskReady.notify_all();
+	for (thread& worker : workers) {
+		worker.join();
+	}
+}
+
+int TaskPool::size() const {
+	return (int)workers.size();
+}
+
+void TaskPool::workerLoop() {
+	while (true) {
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(poolMutex);
+			taskReady.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (tasks.empty()) return; // Stopping and drained
+			task = move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
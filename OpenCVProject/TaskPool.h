@@ -0,0 +1,54 @@
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <memory>
+
+#pragma once
+
+using namespace std;
+
+/// <summary>
+/// Fixed set of long lived worker threads running submitted tasks in order.
+/// Threads stay alive between tasks so per-thread state (ex: CascadeRegistry classifiers) is only built once.
+/// </summary>
+class TaskPool {
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex poolMutex;
+    condition_variable taskReady;
+    bool stopping = false;
+
+public:
+    TaskPool(int threadCount);
+    ~TaskPool();
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    /// <summary>
+    /// Queue task to run on the next free worker.
+    /// </summary>
+    /// <returns> Future with task's result : Rethrows if task threw </returns>
+    template <typename Task>
+    auto submit(Task task) -> future<decltype(task())> {
+        using Result = decltype(task());
+        shared_ptr<packaged_task<Result()>> packaged = make_shared<packaged_task<Result()>>(move(task));
+        future<Result> result = packaged->get_future();
+        {
+            lock_guard<mutex> lock(poolMutex);
+            tasks.push([packaged]() { (*packaged)(); });
+        }
+        taskReady.notify_one();
+        return result;
+    }
+
+    int size() const;
+
+private:
+    void workerLoop();
+};
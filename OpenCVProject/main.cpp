@@ -10,7 +10,26 @@
 #include <filesystem>
 #include <vector>
 #include <time.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <iomanip>
+#include <fstream>
+#include <variant>
+#include <unordered_set>
 #include "Image.h"
+#include "BoundedQueue.h"
+#include "BufferPool.h"
+#include "StageTimings.h"
+#include "ProcessedIndex.h"
+#include "InputSource.h"
+#include "FaceTracker.h"
+#include "Daemon.h"
+#include "OutputEncoder.h"
+#include "RunSettings.h"
 #include "Log.h"
 namespace fs = std::filesystem; // Requires C++17
 
@@ -20,63 +39,230 @@ namespace fs = std::filesystem; // Requires C++17
 
 /* ---------------------------------------- Headers ---------------------------------------- */
 
-inline void generateInputFileList(std::vector <std::string>& inFiles, const std::vector <std::string>& outFiles, const std::string path);
+// Image moving between pipeline stages
+struct PipelineImage {
+	size_t index = 0;
+	std::string path;
+	std::unique_ptr<Image> image;
+	std::string log;			// Captured stage logs : Written in input order
+};
+
+// Image waiting on the encode / write stage
+struct EncodeJob {
+	std::string writePath;
+	cv::Mat image;
+	std::string deletePath;		// Input to delete once written (optional)
+	size_t timingIndex = 0;		// TimingReport row the write time goes to
+	std::string sourcePath;		// Input the image came from : Marked failed in the index if the write fails
+};
+
+// Finished Images waiting to be reused : loadImage() resets them, so their Cascades and buffers carry over
+struct ImagePool {
+	std::mutex poolMutex;
+	std::vector<std::unique_ptr<Image>> images;
+
+	// nullptr when empty : decodeImage() then constructs a new Image
+	std::unique_ptr<Image> acquire() {
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if (images.empty()) return nullptr;
+		std::unique_ptr<Image> image = std::move(images.back());
+		images.pop_back();
+		return image;
+	}
+
+	void recycle(std::unique_ptr<Image> image) {
+		std::lock_guard<std::mutex> lock(poolMutex);
+		images.push_back(std::move(image));
+	}
+};
+
+// Run outcome : Failures from every stage (any thread) for the closing summary and exit code
+struct RunSummary {
+	std::mutex summaryMutex;
+	int images = 0;
+	int positives = 0;
+	std::vector<std::string> failures;	// "path : reason"
+	bool setupFailed = false;			// Bad arguments, config file, input or output path
+
+	void fail(const std::string& path, const std::string& reason) {
+		std::lock_guard<std::mutex> lock(summaryMutex);
+		failures.push_back(path + " : " + reason);
+	}
+
+	// 0 = Every image handled : 1 = Some images failed : 2 = Could not run
+	int exitCode() {
+		std::lock_guard<std::mutex> lock(summaryMutex);
+		if (setupFailed) return 2;
+		return failures.empty() ? 0 : 1;
+	}
+};
+
+// One runtime setting : "--name value" on the command line or "name = value" in a config file
+struct SettingEntry {
+	const char* name;
+	std::variant<bool*, int*, double*, std::string*, DetectionPolicy*> target;
+};
+
+std::unique_ptr<InputSource> generateInputSource(const std::vector <std::string>& outFiles, const std::string path);
+void logInputSummary(const InputSource& input);
+void generateVideo(const std::string& path, const bool& validOutput);
+inline bool isVideoInput(const std::string& path);
 inline void generateOutputFileList(std::vector <std::string>& fileList, const std::string path, bool& isValid);
 void printFileList(const std::vector<std::string>& fileList, std::string name = "", std::string path = "");
-void generateProfileImages(const std::vector<std::string>& inFiles, const bool& validOutput);
+void generateProfileImages(InputSource& input, const bool& validOutput);
+inline void logGenerateTitle(int count, int successCount);
+std::unique_ptr<Image> generateImage(const std::string& path, std::unique_ptr<Image> workspace = nullptr);
+std::unique_ptr<Image> decodeImage(const std::string& path, std::unique_ptr<Image> workspace = nullptr);
+void configureImage(Image& image);
+void detectImage(Image& image);
+int runDaemon();
+void writeImage(const EncodeJob& job, TimingReport& report);
+std::vector<std::thread> startEncodeStage(BoundedQueue<EncodeJob>& encodeQueue, TimingReport& report, std::atomic<long long>& encodeBusy, int threads);
+void handleResult(Image& image, const std::string& path, const bool& validOutput, int& successCount, TimingReport& report, BoundedQueue<EncodeJob>* encodeQueue = nullptr);
+void writeTimingReport(const TimingReport& report, const bool& validOutput);
+void printQueueStats(const QueueStats& stats);
+inline long long elapsedMicroseconds(std::chrono::steady_clock::time_point start);
 inline void displayOutput(const std::vector<string>& outFiles);
 inline void keyContinue();
 inline bool exists(const std::string& name);
-inline bool validateExtension(const std::string& path);
 inline void logSettings();
-void ioHandler(std::vector<std::string>& inFiles, std::vector<std::string>& outFiles, const std::string& inputPath, const std::string& outputPath, bool& validOutput);
+bool parseArguments(int argc, char** argv);
+bool loadConfigFile(const std::string& path);
+bool applySetting(const std::string& name, const std::string& value);
+void printUsage();
+void applyHeadless();
+void logRunSummary();
+bool loadIndex(const bool& validOutput);
+void saveIndex();
+inline std::string fileStem(const std::string& path);
+inline std::string joinPath(const std::string& directory, const std::string& file);
+void ioHandler(std::unique_ptr<InputSource>& input, std::vector<std::string>& outFiles, const std::string& inputPath, const std::string& outputPath, bool& validOutput);
 
 /* ---------------------------------------- SETTINGS ---------------------------------------- */
 
 // FileIO : File/Folder Input : Folder Output
-const string inputPath = "\\Users\\djhat\\OneDrive\\Pictures\\Input_Heve\\";
-const string outputPath = "\\Users\\djhat\\OneDrive\\Pictures\\Output_Heve\\";
-const string failPath = ".\\Resources\\Failures\\"; // Optional : ! THERE ARE NO CHECKS ON THIS SO BE CAREFUL !
+string inputPath = "./Resources/Input/";
+string outputPath = "./Resources/Output/";
+string failPath = "./Resources/Failures/"; // Optional : ! THERE ARE NO CHECKS ON THIS SO BE CAREFUL !
 
 // Meta Settings :
-const bool headless = false; // Run without UI
+bool headless = false;                 // Batch mode : Never opens a window or waits on a key, no debug images (forces displayLog / showOutput off)
 const Size profileSize = Size(720, 720);
+bool compiledCascades = false;         // Detect with precompiled .hcc cascades : Skips XML parsing on warm starts
+int batchWorkers = 1;                  // Images generated in parallel : 0 = One per core : > 1 runs the staged pipeline
+int pipelineDepth = 4;                 // Queue capacity between pipeline stages (decode -> detect, result -> encode)
+int encodeWorkers = 1;                 // Threads encoding / writing output while later images are detected : 0 = Write inline (pipeline keeps 1)
+bool reuseImages = true;               // Finished Images (and their Cascades) are reset and reused for the next path
+bool simdCascades = true;              // compiledCascades : Stump cascades evaluate 4 / 8 windows at once (SSE4.1 / AVX2) when the CPU has it
+bool verifySimd = false;               // Also run the scalar evaluator on every SIMD window (slow) : Logs the disagreement rate
+double simdTolerance = 0.0001;         // verifySimd : Disagreement rate above which the run logs an error
+bool verifyOpenCV = false;             // compiledCascades : Also run OpenCV's CascadeClassifier on every image (slow) and match its rects (IoU >= 0.5)
+double openCVTolerance = 0.05;         // verifyOpenCV : Share of unmatched rects above which the run logs an error
+bool timingReport = false;             // Write per image stage timings and their p50 / p95 / p99 / max to outputPath : Opt in (--timingReport / config)
+bool timingCsv = false;                // timingReport : timings.csv + timings_summary.csv instead of timings.json
+bool incrementalIndex = false;         // Opt in : Skip inputs the index has already processed unless their contents changed, even if their output was deleted since
+                                       // (paths it has no entry for still get the output name check)
+std::string indexPath = "";            // incrementalIndex : Empty = heve_index.txt in outputPath
+
+// Detection Settings : reducedDecode, pooledBuffers, faceRegionEyes, parallelCascades and detectionPolicy are in runSettings (defaults shared with Benchmark and Sweep)
+RunSettings runSettings;
+bool detectionCache = false;           // Opt in : Reuse the rects of earlier runs for the same pixels and detection settings (render only reruns skip detection)
+std::string detectionCachePath = "./Resources/DetectionCache/";
+int detectionCacheMB = 64;             // detectionCache : Least recently used entries are evicted past this size : 0 = No limit
 
 // Input Settings
-const bool deleteFailures = false;      // Deletes negative heve profiles from input path : Quickens Future Runs
-const bool storeFailures = false;       // Only set if failPath is valid : ! THERE ARE NO CHEKS ON THIS SO BE CAREFUL !
-const bool deleteSuccesses = false;    // KEEP AS FALSE : Delete positive heve profiles from input path : Use overrideDuplicates instead for 95% of cases
+bool deleteFailures = false;            // Deletes negative heve profiles from input path : Quickens Future Runs
+bool storeFailures = false;             // Only set if failPath is valid : ! THERE ARE NO CHEKS ON THIS SO BE CAREFUL !
+bool deleteSuccesses = false;          // KEEP AS FALSE : Delete positive heve profiles from input path : Use overrideDuplicates instead for 95% of cases
+bool recursiveInput = false;           // Also read images in sub folders of inputPath
 
 // Ouput Settings
-const bool storeImage = true;		   // If store image in outputDestination
-const bool overrideDuplicates = false; // Generate item even if duplicate already exists in output
-const bool showOutput = true;	       // Show all contents of output 
+bool storeImage = true;		         // If store image in outputDestination
+bool overrideDuplicates = false;       // Generate item even if duplicate already exists in output
+bool showOutput = true;	             // Show all contents of output 
+std::string outputFormat = "";         // jpg / png / webp : Empty = Keep each input's format
+int outputQuality = 95;                // JPEG / WebP quality (1 - 100)
+int pngCompression = 1;                // PNG zlib level (0 - 9) : Higher is smaller but often costs more than detection
+
+// Render Settings
+std::string overlayPath = "";          // Image (alpha kept) stretched over the mouth in place of the mustache ellipse : Empty = Ellipse
+bool simdOverlay = true;               // Blend the face overlay 4 / 8 pixels at once (SSE4.1 / AVX2) when the CPU has it
+
+// Video Settings : inputPath is a video file or a numbered frame sequence ("frame_%04d.png")
+int keyframeInterval = 10;             // Run every cascade on every Nth frame : Frames in between are tracked (1 = Detect every frame)
+double trackingConfidence = 0.6;       // Match score (0 - 1) below which a tracked frame is detected again
+
+// Daemon Settings : Serve requests over a Unix domain socket instead of reading inputPath (see Daemon.h for the protocol)
+bool daemonMode = false;               // Implies headless : batchWorkers workers keep their Cascades loaded between requests
+std::string socketPath = "heve.sock";
+int daemonQueueDepth = 64;             // Requests waiting for a worker : A full queue answers busy at once
+int daemonMaxConnections = 64;         // Clients served at once (one reader thread each) : Further ones are refused
 
 // Display Settings
-const bool displayLog = true;	       // Display each image as it is generated
-const bool showDebugImage = true ;	   // Debug draw all rectangle cascades
-const bool showCascadeImage = true;    // Draw final cascades
-const bool showProfileImage = true;    // Draw final image
-const bool skipFails = false;		   // Draw negative matches
+bool displayLog = true;	             // Display each image as it is generated
+bool showDebugImage = true ;	         // Debug draw all rectangle cascades
+bool showCascadeImage = true;          // Draw final cascades
+bool showProfileImage = true;          // Draw final image
+bool skipFails = false;		         // Draw negative matches
+
+// Runtime Configuration : Every setting above can be overridden without rebuilding (see printUsage())
+const std::vector<SettingEntry> settingTable = {
+	{ "inputPath", &inputPath }, { "outputPath", &outputPath }, { "failPath", &failPath },
+	{ "headless", &headless }, { "reducedDecode", &runSettings.reducedDecode }, { "compiledCascades", &compiledCascades },
+	{ "batchWorkers", &batchWorkers }, { "pipelineDepth", &pipelineDepth }, { "encodeWorkers", &encodeWorkers },
+	{ "pooledBuffers", &runSettings.pooledBuffers }, { "reuseImages", &reuseImages }, { "simdCascades", &simdCascades },
+	{ "verifySimd", &verifySimd }, { "simdTolerance", &simdTolerance },
+	{ "verifyOpenCV", &verifyOpenCV }, { "openCVTolerance", &openCVTolerance }, { "timingReport", &timingReport }, { "timingCsv", &timingCsv },
+	{ "incrementalIndex", &incrementalIndex }, { "indexPath", &indexPath },
+	{ "faceRegionEyes", &runSettings.faceRegionEyes }, { "parallelCascades", &runSettings.parallelCascades }, { "detectionPolicy", &runSettings.detectionPolicy },
+	{ "detectionCache", &detectionCache }, { "detectionCachePath", &detectionCachePath }, { "detectionCacheMB", &detectionCacheMB },
+	{ "deleteFailures", &deleteFailures }, { "storeFailures", &storeFailures }, { "deleteSuccesses", &deleteSuccesses }, { "recursiveInput", &recursiveInput },
+	{ "storeImage", &storeImage }, { "overrideDuplicates", &overrideDuplicates }, { "showOutput", &showOutput },
+	{ "outputFormat", &outputFormat }, { "outputQuality", &outputQuality }, { "pngCompression", &pngCompression },
+	{ "overlayPath", &overlayPath }, { "simdOverlay", &simdOverlay },
+	{ "keyframeInterval", &keyframeInterval }, { "trackingConfidence", &trackingConfidence },
+	{ "daemonMode", &daemonMode }, { "socketPath", &socketPath }, { "daemonQueueDepth", &daemonQueueDepth },
+	{ "daemonMaxConnections", &daemonMaxConnections },
+	{ "displayLog", &displayLog }, { "showDebugImage", &showDebugImage }, { "showCascadeImage", &showCascadeImage },
+	{ "showProfileImage", &showProfileImage }, { "skipFails", &skipFails }
+};
+
+RunSummary runSummary;
+OutputEncoder outputEncoder; // Built from the Ouput Settings once they are parsed
+ProcessedIndex processedIndex;
+bool indexActive = false; // incrementalIndex and the index could be loaded
+
+// Why inputs were skipped : Counted by the input filter, read once the input is exhausted
+struct InputSkips {
+	int unchanged = 0;		// Index says already processed
+	int duplicates = 0;		// Output with the same name exists
+} inputSkips;
 
 // Log Settings
 inline void logSettings() {
 	Log::headless = false;				// Headless Option - No Logging
+	Log::async = true;					// Console writes happen on a writer thread instead of the logging thread
 
-	Log::whitelist("ERROR");			// Log Errors
-	Log::whitelist("TITLE");			// Fancy Title Box
-	Log::whitelist("VALIDATE_INPUT");	// Log Input Summary
-	Log::whitelist("INPUT_LIST");		// Print File Input List
-	Log::blacklist("OUTPUT_LIST");		// Print File Output List
-	Log::whitelist("GENERATE");			// Generation Titles / Frame
-	Log::whitelist("GENERATE_TITLE");	// Line Title of Generation Data
-	Log::blacklist("GENERATE_INFO");	// All function info exept for Cascade and Face Data
-	Log::whitelist("CASCADE");			// Log detectMultiScale cascades
-	Log::blacklist("FACE");				// Log faceFeature function
-	Log::blacklist("DRAW_FACE");		// Log drawFace function
-	Log::whitelist("RESULT");			// Display Result of Generation
+	Log::whitelist(LOG_ERROR);				// Log Errors
+	Log::whitelist(LOG_TITLE);				// Fancy Title Box
+	Log::whitelist(LOG_VALIDATE_INPUT);		// Log Input Summary
+	Log::whitelist(LOG_INPUT_LIST);			// Print each input path as it is generated
+	Log::blacklist(LOG_OUTPUT_LIST);		// Print File Output List
+	Log::whitelist(LOG_GENERATE);			// Generation Titles / Frame
+	Log::whitelist(LOG_GENERATE_TITLE);		// Line Title of Generation Data
+	Log::blacklist(LOG_GENERATE_INFO);		// All function info exept for Cascade and Face Data
+	Log::whitelist(LOG_CASCADE);			// Log detectMultiScale cascades
+	Log::blacklist(LOG_FACE);				// Log faceFeature function
+	Log::blacklist(LOG_DRAW_FACE);			// Log drawFace function
+	Log::whitelist(LOG_RESULT);				// Display Result of Generation
+	Log::whitelist(LOG_PIPELINE);			// Pipeline stage busy time, queue depth and stalls
+	Log::whitelist(LOG_DETECTION);			// Cascade runs / skips for the whole run
+	Log::whitelist(LOG_MEMORY);				// Buffer pool allocations / reuse
+	Log::whitelist(LOG_TIMING);				// Stage timing percentiles for the whole run
+	Log::whitelist(LOG_SUMMARY);			// Run totals and every failed image (always worth keeping for batch runs)
 
 	// Use Log::printIds() to view all mapped blacklist/whitelist keys
+	// Define LOG_DISABLED_CHANNELS (LogChannel bit mask) to compile channels out of the build entirely
 }
 
 /* ------------------------------------ [ TODO LIST ] ----------------------------------- /*
@@ -89,42 +275,296 @@ inline void logSettings() {
 * MAKE LOG CLASS BASED OFF OF NAMESPACE AND USE INLINE OR SOMETHING LIKE THAT I THINK LOLOL
 /* ---------------------------------------- Main ---------------------------------------- */
 
-int main() {
+int main(int argc, char** argv) {
 	using namespace std;
 	using namespace cv;
 	utils::logging::setLogLevel(utils::logging::LogLevel::LOG_LEVEL_ERROR); // Log Level : Errors :
 
-	// Setting Parity 
+	// Runtime Configuration : Command line and config files override the defaults above
 	logSettings();
+	if (!parseArguments(argc, argv)) {
+		Log::stop();
+		return runSummary.exitCode();
+	}
+	applyHeadless();
+	OutputEncoder::Format format;
+	if (!OutputEncoder::parseFormat(outputFormat, format)) {
+		Log::println("[ERROR] Unknown outputFormat \"" + outputFormat + "\" (jpg / png / webp)", LOG_ERROR);
+		runSummary.setupFailed = true;
+		Log::stop();
+		return runSummary.exitCode();
+	}
+
+	// Setting Parity 
+	outputEncoder = OutputEncoder(format, outputQuality, pngCompression);
+	runSettings.applyProcess(); // Before any Mat is created
+	Cascade::useCompiled = compiledCascades;
+	unique_ptr<DetectionCache> cache;
+	if (detectionCache) {
+		cache = make_unique<DetectionCache>(detectionCachePath, (size_t)max(detectionCacheMB, 0) * 1024 * 1024);
+		if (cache->isValid()) Image::detectionCache = cache.get();
+		else Log::println("[ERROR] Could not open detection cache \"" + detectionCachePath + "\" [Detecting every image]", LOG_ERROR);
+	}
+	if (!simdCascades) CompiledCascade::simd = CompiledCascade::SIMD_NONE;
+	CompiledCascade::verifySimd = verifySimd;
+	Cascade::verifyOpenCV = verifyOpenCV && compiledCascades;
+	if (!simdOverlay) OverlayCompositor::simd = CompiledCascade::SIMD_NONE;
+	if (!overlayPath.empty() && !OverlayCompositor::loadAsset(overlayPath, Image::mustacheOverlay)) {
+		Log::println("[ERROR] Could not read overlay \"" + overlayPath + "\" [Drawing the mustache]", LOG_ERROR);
+	}
+
+	// Daemon : Requests replace inputPath / outputPath
+	if (daemonMode) {
+		int code = runDaemon();
+		Log::stop();
+		return code;
+	}
 	
 	// Persistent Variables :
-	vector<string> inFiles;
+	unique_ptr<InputSource> input; // Read while generating
 	vector<string> outFiles;
 	bool validOutput; // True if outputPath exists
 
 	// Input / Output Setup :
-	ioHandler(inFiles, outFiles, inputPath, outputPath, validOutput);
+	ioHandler(input, outFiles, inputPath, outputPath, validOutput);
+	if (storeImage && !validOutput) runSummary.setupFailed = true; // Every positive would be lost
 
 	// GENERATE 
-	generateProfileImages(inFiles, validOutput);
+	if (!runSummary.setupFailed && input) {
+		generateProfileImages(*input, validOutput);
+		logInputSummary(*input);
+	}
+	else if (!runSummary.setupFailed) {
+		generateVideo(inputPath, validOutput);
+	}
 	
 	// Display Output :
 	displayOutput(outFiles);
 
+	saveIndex();
+	logRunSummary();
+	Log::stop();
+	return runSummary.exitCode();
+}
+
+/* ---------------------------------------- Configuration ---------------------------------------- */
+
+/// <summary>
+/// Apply command line settings in order : "--config PATH" loads a file at that point, so later arguments override it.
+/// "--name value" sets any setting in settingTable, a bool given without a value is set to true.
+/// "--input" / "--output" are short for inputPath / outputPath.
+/// </summary>
+/// <returns> False when the run should stop (bad argument or --help) </returns>
+bool parseArguments(int argc, char** argv) {
+	using namespace std;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			printUsage();
+			return false;
+		}
+		if (!arg.starts_with("--")) {
+			Log::println("[ERROR] Unexpected argument \"" + arg + "\" (see --help)", LOG_ERROR);
+			runSummary.setupFailed = true;
+			return false;
+		}
+
+		string name = arg.substr(2);
+		if (name == "input") name = "inputPath";
+		else if (name == "output") name = "outputPath";
+
+		// Bools may be given as a bare flag
+		bool hasValue = (i + 1 < argc) && !string(argv[i + 1]).starts_with("--");
+		string value = hasValue ? argv[++i] : "true";
+
+		if (name == "config" && !hasValue) {
+			Log::println("[ERROR] --config needs a file path", LOG_ERROR);
+		}
+		bool applied = (name == "config") ? hasValue && loadConfigFile(value) : applySetting(name, value);
+		if (!applied) {
+			runSummary.setupFailed = true;
+			return false;
+		}
+	}
+	return true;
+}
+
+// "name = value" per line : Blank lines and lines starting with # are skipped
+bool loadConfigFile(const std::string& path) {
+	using namespace std;
+	ifstream file(path);
+	if (!file) {
+		Log::println("[ERROR] Could not open config file \"" + path + "\"", LOG_ERROR);
+		return false;
+	}
+
+	auto trim = [](string text) {
+		size_t first = text.find_first_not_of(" \t\r");
+		size_t last = text.find_last_not_of(" \t\r");
+		return (first == string::npos) ? string() : text.substr(first, last - first + 1);
+	};
+
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		lineNumber++;
+		line = trim(line);
+		if (line.empty() || line[0] == '#') continue;
+
+		size_t equals = line.find('=');
+		if (equals == string::npos) {
+			Log::println("[ERROR] " + path + ":" + to_string(lineNumber) + " : Expected \"name = value\"", LOG_ERROR);
+			return false;
+		}
+		if (!applySetting(trim(line.substr(0, equals)), trim(line.substr(equals + 1)))) return false;
+	}
+	return true;
+}
+
+// Parse value into the setting called name
+bool applySetting(const std::string& name, const std::string& value) {
+	using namespace std;
+	auto entry = find_if(settingTable.begin(), settingTable.end(), [&](const SettingEntry& setting) { return name == setting.name; });
+	if (entry == settingTable.end()) {
+		Log::println("[ERROR] Unknown setting \"" + name + "\" (see --help)", LOG_ERROR);
+		return false;
+	}
+
+	string lowered = value;
+	transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+	bool valid = true;
+	try {
+		if (auto target = get_if<bool*>(&entry->target)) {
+			if (lowered == "true" || lowered == "1" || lowered == "yes" || lowered == "on") **target = true;
+			else if (lowered == "false" || lowered == "0" || lowered == "no" || lowered == "off") **target = false;
+			else valid = false;
+		}
+		else if (auto target = get_if<int*>(&entry->target)) {
+			size_t used;
+			**target = stoi(value, &used);
+			valid = (used == value.size());
+		}
+		else if (auto target = get_if<double*>(&entry->target)) {
+			size_t used;
+			**target = stod(value, &used);
+			valid = (used == value.size());
+		}
+		else if (auto target = get_if<string*>(&entry->target)) {
+			**target = value;
+		}
+		else if (auto target = get_if<DetectionPolicy*>(&entry->target)) {
+			if (lowered == "both") **target = DETECT_BOTH;
+			else if (lowered == "real_first") **target = DETECT_REAL_FIRST;
+			else if (lowered == "anime_first") **target = DETECT_ANIME_FIRST;
+			else if (lowered == "auto") **target = DETECT_AUTO;
+			else valid = false;
+		}
+	}
+	catch (const exception&) {
+		valid = false; // stoi / stod : Not a number or out of range
+	}
+
+	if (!valid) {
+		Log::println("[ERROR] Invalid value \"" + value + "\" for " + name, LOG_ERROR);
+	}
+	return valid;
+}
+
+void printUsage() {
+	Log::println("Usage : Heve_Starvey_Filter [--config PATH] [--input PATH] [--output PATH] [--headless] [--name value]...");
+	Log::println("Exit code : 0 = Every image handled : 1 = Some images failed : 2 = Could not run");
+	Log::println("Settings (also \"name = value\" lines in a config file) :");
+	for (const SettingEntry& setting : settingTable) {
+		const char* type = std::visit([](auto target) -> const char* {
+			using Target = std::remove_pointer_t<decltype(target)>;
+			if constexpr (std::is_same_v<Target, bool>) return "true / false";
+			else if constexpr (std::is_same_v<Target, int>) return "integer";
+			else if constexpr (std::is_same_v<Target, double>) return "number";
+			else if constexpr (std::is_same_v<Target, DetectionPolicy>) return "both / real_first / anime_first / auto";
+			else return "text";
+		}, setting.target);
+		Log::println(std::string("    --") + setting.name + " : " + type);
+	}
+}
+
+// Batch mode : Nothing may open a window or wait on a key, and nothing draws the debug images only windows would show
+void applyHeadless() {
+	if (daemonMode) headless = true; // Nobody is watching a daemon's windows
+	if (!headless) return;
+	displayLog = false;
+	showOutput = false;
+	showDebugImage = false;
+	showCascadeImage = false;
+	showProfileImage = false;
+}
+
+// Totals and every failure : Printed last so batch logs end with the outcome
+void logRunSummary() {
+	using namespace std;
+	lock_guard<mutex> lock(runSummary.summaryMutex);
+	Log::pushKey(LOG_SUMMARY);
+	startlog << "Summary : [" << runSummary.images << " Images] [" << runSummary.positives << " Positives] ["
+		<< runSummary.failures.size() << " Failures]" << (runSummary.setupFailed ? " [Setup Failed]" : "") << endl << endlog;
+	for (const string& failure : runSummary.failures) {
+		startlog << "[FAILED] " << failure << endl << endlog;
+	}
+	Log::popKey(); // SUMMARY
+}
+
+// Open the incremental index : False = Run without one (disabled, or nowhere to keep it)
+bool loadIndex(const bool& validOutput) {
+	using namespace std;
+	if (!incrementalIndex) return false;
+	if (indexPath.empty()) {
+		if (!validOutput) return false;
+		indexPath = joinPath(outputPath, "heve_index.txt");
+	}
+	// Key of this run's detection settings : Results found with other settings may differ
+	Image settings;
+	configureImage(settings);
+	if (!processedIndex.load(indexPath, settings.settingsKey())) {
+		Log::println("[ERROR] Could not read index \"" + indexPath + "\" [Running without it]", LOG_ERROR);
+		return false;
+	}
+	startlog << "Index : [" << processedIndex.size() << " Entries] " << endlog;
+	return true;
+}
+
+// Keep this run's results for the next one : Unwritten results only cost a reprocess, so this is not a run failure
+void saveIndex() {
+	if (indexActive && !processedIndex.save()) {
+		Log::println("[ERROR] Could not write index \"" + indexPath + "\"", LOG_ERROR);
+	}
+}
+
+// Daemon mode : Serve until SIGINT / SIGTERM / a shutdown request : 2 = Could not listen
+int runDaemon() {
+	using namespace std;
+	int workers = (batchWorkers > 0) ? batchWorkers : max(1, (int)thread::hardware_concurrency());
+	Daemon daemon(socketPath, workers, (size_t)max(daemonQueueDepth, 1), (size_t)max(daemonMaxConnections, 1), configureImage);
+	int code = daemon.run();
+
+	Daemon::Stats stats = daemon.stats();
+	Log::pushKey(LOG_SUMMARY);
+	startlog << "Daemon : [" << stats.connections << " Connections] [" << stats.jobs << " Jobs] [" << stats.positives << " Positives] ["
+		<< stats.errors << " Errors] [" << stats.rejected << " Busy] [" << stats.refused << " Refused]" << endl << endlog;
+	Log::popKey(); // SUMMARY
+	return code;
 }
 
 /* ---------------------------------------- Functions ---------------------------------------- */
 
 /// <summary>
 /// Super-impose Steve Harvey on all input : Save valid generated image profiles into output folder : Uses haarcascades with OpenCV library 
+/// With batchWorkers != 1 images are generated on worker threads, results and logs are still handled in input order on this thread
 /// </summary>
-/// <param name="inFiles"> : Validated Input File Paths </param>
+/// <param name="input"> : Validated Input File Paths, read as they are found so the first image starts right away </param>
 /// <param name="validOutput"> : If output directory exists (might change how this works eventualy) </param>
-void generateProfileImages(const std::vector<std::string>& inFiles, const bool& validOutput) {
+void generateProfileImages(InputSource& input, const bool& validOutput) {
 	using namespace std;
 	using namespace cv;
 
-	Log::pushKey("GENERATE");
+	Log::pushKey(LOG_GENERATE);
 	Log::print("\n");
 	Log::print("----------------------------------------\n");
 	Log::print("|        [ +++ Generating +++ ]        |\n");
@@ -133,103 +573,539 @@ void generateProfileImages(const std::vector<std::string>& inFiles, const bool&
 
 	int count = 0;
 	int successCount = 0;
-	for (string path : inFiles) {
+	int cascadeRuns = 0;		// Cascades run / skipped by detectionPolicy and faceRegionEyes
+	int skippedCascades = 0;
+	TimingReport report;		// Stage times of every image, in input order
+	int workers = (batchWorkers > 0) ? batchWorkers : max(1, (int)thread::hardware_concurrency());
 
-		// Log :
-		Log::pushKey("GENERATE_INFO");
+	if (workers == 1) {
+		// Encode : Writes overlap the next image's decode and detect (encodeWorkers = 0 writes inline)
+		BoundedQueue<EncodeJob> encodeQueue("result -> encode", pipelineDepth);
+		atomic<long long> encodeBusy = 0;
+		vector<thread> encodeStage = startEncodeStage(encodeQueue, report, encodeBusy, encodeWorkers);
+		BoundedQueue<EncodeJob>* writes = encodeStage.empty() ? nullptr : &encodeQueue;
 
-		Log::pushKey("GENERATE_TITLE");
-		Log::stream << "Generating : [" << ++count << " / " << inFiles.size() << "] [" << successCount << " Positives]" << endl << endlog;
-		Log::popKey(); // GENERATE_TITLE
+		unique_ptr<Image> image; // Reused for every path : loadImage() releases faceImage, so a queued write keeps its own pixels
+		string path;
+		while (input.next(path)) {
+			Log::println("Input : " + path, LOG_INPUT_LIST);
+			logGenerateTitle(++count, successCount);
 
-		// GENERATE :
-		Image image = Image(path);
-		image.generateAll();
-		image.drawDebugCascades();
-		if (showDebugImage) image.drawDebugAllCascades();
-		Log::popKey(); // GENERATE_INFO
+			// GENERATE :
+			image = generateImage(path, reuseImages ? move(image) : nullptr);
 
-		// Result :
-		Log::pushKey("RESULT");
-		// EVALUATE :
-		if (image.checkForFaceImage) {
-			// LOG :
-			if (displayLog) { 
-				if (showDebugImage || showCascadeImage) {
-					imshow(image.name, image.debugImage); keyContinue();
-				}
-				if (showProfileImage) {
-					imshow(image.name, image.faceImage); keyContinue();
+			// Result :
+			handleResult(*image, path, validOutput, successCount, report, writes);
+			cascadeRuns += image->cascadeRuns;
+			skippedCascades += image->skippedCascades;
+		}
+
+		encodeQueue.close();
+		for (thread& t : encodeStage) t.join();
+		if (writes) {
+			Log::pushKey(LOG_PIPELINE);
+			startlog << "Encode : [" << encodeStage.size() << " Workers] busy " << encodeBusy / 1000 << " ms" << endl << endlog;
+			printQueueStats(encodeQueue.stats());
+			Log::popKey(); // PIPELINE
+		}
+	}
+	else {
+		// Pipeline : decode -> detect / render (workers) -> result (this thread, input order) -> encode / write
+		BoundedQueue<PipelineImage> decodeQueue("decode -> detect", pipelineDepth);
+		OrderedQueue<PipelineImage> resultQueue("detect -> result", (size_t)workers * 2);
+		BoundedQueue<EncodeJob> encodeQueue("result -> encode", pipelineDepth);
+		atomic<long long> decodeBusy = 0, detectBusy = 0, encodeBusy = 0; // Microseconds
+		ImagePool imagePool;
+
+		// Decode : Prefetch images in input order, straight from the directory walk
+		thread decodeStage([&]() {
+			size_t decoded = 0;
+			string path;
+			while (input.next(path)) {
+				auto start = chrono::steady_clock::now();
+				PipelineImage item;
+				item.index = decoded;
+				item.path = path;
+				Log::beginCapture();
+				item.image = decodeImage(path, reuseImages ? imagePool.acquire() : nullptr);
+				item.log = Log::endCapture();
+				decodeBusy += elapsedMicroseconds(start);
+				if (!decodeQueue.push(move(item))) break;
+				decoded++;
+			}
+			decodeQueue.close();
+			resultQueue.close(decoded); // Input count is only known now
+		});
+
+		// Detect / Render :
+		vector<thread> detectStage;
+		for (int t = 0; t < workers; t++) {
+			detectStage.emplace_back([&]() {
+				PipelineImage item;
+				while (decodeQueue.pop(item)) {
+					auto start = chrono::steady_clock::now();
+					Log::beginCapture();
+					detectImage(*item.image);
+					item.log += Log::endCapture();
+					detectBusy += elapsedMicroseconds(start);
+					resultQueue.push(item.index, move(item));
 				}
+			});
+		}
+
+		// Encode / Write :
+		vector<thread> encodeStage = startEncodeStage(encodeQueue, report, encodeBusy, max(1, encodeWorkers));
+
+		// Result : Display / queue writes in input order
+		PipelineImage item;
+		while (resultQueue.pop(item)) {
+			Log::println("Input : " + item.path, LOG_INPUT_LIST);
+			logGenerateTitle(++count, successCount);
+			Log::write(item.log);
+			handleResult(*item.image, item.path, validOutput, successCount, report, &encodeQueue);
+			cascadeRuns += item.image->cascadeRuns;
+			skippedCascades += item.image->skippedCascades;
+			if (reuseImages) imagePool.recycle(move(item.image));
+		}
+
+		decodeStage.join();
+		for (thread& t : detectStage) t.join();
+		encodeQueue.close();
+		for (thread& t : encodeStage) t.join();
+
+		// Report :
+		Log::pushKey(LOG_PIPELINE);
+		startlog << "Pipeline : [" << workers << " Detect Workers] [" << max(1, encodeWorkers) << " Encode Workers]" << endl << endlog;
+		startlog << "[decode] busy " << decodeBusy / 1000 << " ms" << endl << endlog;
+		startlog << "[detect] busy " << detectBusy / 1000 << " ms" << endl << endlog;
+		startlog << "[encode] busy " << encodeBusy / 1000 << " ms" << endl << endlog;
+		printQueueStats(decodeQueue.stats());
+		printQueueStats(resultQueue.stats());
+		printQueueStats(encodeQueue.stats());
+		Log::print("----------------------------------------\n");
+		Log::popKey(); // PIPELINE
+	}
+
+	Log::pushKey(LOG_DETECTION);
+	startlog << "Detection : [" << cascadeRuns << " Cascade Runs] [" << skippedCascades << " Skipped]" << endl << endlog;
+	if (Image::detectionCache) {
+		DetectionCache::Stats cache = Image::detectionCache->stats();
+		startlog << "Detection Cache : [" << cache.hits << " Hits] [" << cache.misses << " Misses] [" << cache.evictions << " Evicted] ["
+			<< cache.entries << " Entries] [" << cache.bytes / 1024 << " KB]" << endl << endlog;
+	}
+	if (verifySimd && CompiledCascade::verifiedWindows > 0) {
+		double mismatchRate = (double)CompiledCascade::mismatchedWindows / CompiledCascade::verifiedWindows;
+		startlog << "SIMD Verify : [" << CompiledCascade::verifiedWindows << " Windows] [" << CompiledCascade::mismatchedWindows << " Mismatched]" << endl << endlog;
+		if (mismatchRate > simdTolerance) {
+			Log::println("[ERROR] SIMD evaluator disagrees with scalar on " + to_string(mismatchRate * 100) + "% of windows", LOG_ERROR);
+		}
+	}
+	if (Cascade::verifyOpenCV) {
+		long long reference = Cascade::referenceRects, compiled = Cascade::compiledRects, matched = Cascade::matchedRects;
+		long long unmatched = (reference - matched) + (compiled - matched);
+		double mismatchRate = (reference + compiled > 0) ? (double)unmatched / max(reference, compiled) : 0;
+		startlog << "OpenCV Verify : [" << reference << " OpenCV Rects] [" << compiled << " Compiled Rects] [" << matched << " Matched]" << endl << endlog;
+		if (mismatchRate > openCVTolerance) {
+			Log::println("[ERROR] Compiled cascades disagree with OpenCV on " + to_string(mismatchRate * 100) + "% of rects", LOG_ERROR);
+		}
+	}
+	Log::popKey(); // DETECTION
+
+	if (runSettings.pooledBuffers) {
+		BufferPool::Stats pool = BufferPool::instance().stats();
+		Log::pushKey(LOG_MEMORY);
+		startlog << "Buffer Pool : [" << pool.allocations << " Allocations] [" << pool.reuses << " Reused] ["
+			<< pool.peakBytes / (1024 * 1024) << " MB Peak]" << endl << endlog;
+		Log::popKey(); // MEMORY
+	}
+
+	Log::pushKey(LOG_TIMING);
+	report.log();
+	if (timingReport) writeTimingReport(report, validOutput);
+	Log::popKey(); // TIMING
+
+	Log::pushKey(LOG_GENERATE);
+	Log::print("----------------------------------------\n");
+	Log::print("|   [ +++ Generation Complete +++ ]    |\n");
+	Log::print("----------------------------------------\n\n");
+	Log::popKey(); // GENERATE
+
+}
+
+/// <summary>
+/// Video mode : Read path with VideoCapture (video file or numbered frame sequence), write the processed frames to outputPath as "name_heve.mp4".
+/// Every cascade runs only on keyframes (every keyframeInterval frames, or when tracking confidence drops), FaceTracker moves the rects in between.
+/// </summary>
+void generateVideo(const std::string& path, const bool& validOutput) {
+	using namespace std;
+	using namespace cv;
+
+	Log::pushKey(LOG_GENERATE);
+	Log::print("\n");
+	Log::print("----------------------------------------\n");
+	Log::print("|     [ +++ Generating Video +++ ]     |\n");
+	Log::print("----------------------------------------\n\n");
+	Log::popKey();
+
+	VideoCapture capture(path);
+	if (!capture.isOpened()) {
+		Log::println("[ERROR] Could not open video \"" + path + "\"", LOG_ERROR);
+		runSummary.setupFailed = true;
+		return;
+	}
+	double fps = capture.get(CAP_PROP_FPS);
+	if (!(fps > 0)) fps = 30; // Frame sequences have no rate
+
+	// Output : Opened on the first frame (size is the normalized frame size)
+	bool store = storeImage && validOutput;
+	string name = fileStem(path);
+	name.erase(remove(name.begin(), name.end(), '%'), name.end());
+	string writePath = joinPath(outputPath, name + "_heve.mp4");
+	VideoWriter writer;
+
+	Image image; // Settings and Cascades are reused by every frame : Frames come in through loadFrame()
+	configureImage(image);
+	image.debugDrawing = false;
+	FaceTracker tracker;
+	tracker.minConfidence = trackingConfidence;
+
+	TimingReport report;
+	Mat frame;
+	int frames = 0, positives = 0, keyframes = 0, lostTracks = 0, cascadeRuns = 0;
+	int sinceKeyframe = 0;
+	auto start = chrono::steady_clock::now();
+	while (true) {
+		long long readTime = -1;
+		bool read;
+		{
+			StageTimer timer(readTime);
+			read = capture.read(frame);
+		}
+		if (!read) break;
+
+		Log::pushKey(LOG_GENERATE_INFO);
+		image.loadFrame(frame, path);
+		image.timings.path = path + "#" + to_string(frames);
+		image.timings.microseconds[STAGE_DECODE] = readTime;
+		image.generateNormalizedImage();
+		image.generateGrayscaleImage();
+
+		// Keyframe when due or when a tracked rect is lost
+		bool due = sinceKeyframe >= keyframeInterval || !tracker.isStarted();
+		bool tracked = !due && image.trackCascades(tracker);
+		if (!tracked) {
+			if (!due) lostTracks++;
+			image.generateCascades();
+			tracker.start(image.grayscale, image.cascadeRects());
+			cascadeRuns += image.cascadeRuns;
+			keyframes++;
+			sinceKeyframe = 0;
+		}
+		sinceKeyframe++;
+		image.generateFaceImage();
+		Log::popKey(); // GENERATE_INFO
+
+		// faceImage is the output frame, positive or not : Every frame is written
+		if (store && !writer.isOpened()) {
+			writer.open(writePath, VideoWriter::fourcc('m', 'p', '4', 'v'), fps, image.faceImage.size());
+			if (!writer.isOpened()) {
+				Log::println("[ERROR] Could not write \"" + writePath + "\"", LOG_ERROR);
+				runSummary.fail(writePath, "could not write");
+				store = false;
 			}
-			// SAVE :
-			if (storeImage && validOutput) {
-				Log::stream << "Storing Image : " << endlog;
-				string writePath = outputPath + image.name + image.ext;
-				imwrite(writePath, image.faceImage);
-				Log::stream << "[-Successful-]" << endl << endlog;
-			} else if (storeImage) {
-				Log::stream << "Invalid Output Directory [Could not save image]" << endl << endlog;
+		}
+		if (store) {
+			StageTimer timer(image.timings.microseconds[STAGE_WRITE]);
+			writer.write(image.faceImage);
+		}
+		if (displayLog && !headless) {
+			imshow(image.name, image.faceImage);
+			waitKey(1); // Preview only : Never waits on a key
+		}
+
+		frames++;
+		image.timings.positive = image.checkForFaceImage;
+		report.add(image.timings);
+		runSummary.images++;
+		if (image.checkForFaceImage) {
+			positives++;
+			runSummary.positives++;
+		}
+		if (frames % 100 == 0) logGenerateTitle(frames, positives);
+	}
+	writer.release();
+	if (displayLog && !headless) destroyAllWindows();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if (frames == 0) {
+		Log::println("[ERROR] No frames in \"" + path + "\"", LOG_ERROR);
+		runSummary.fail(path, "no frames");
+	}
+	else if (store) {
+		startlog << "Storing Video : \"" << writePath << "\" [-Successful-]" << endl << endlog;
+	}
+
+	Log::pushKey(LOG_DETECTION);
+	startlog << "Video : [" << frames << " Frames] [" << positives << " Positives] [" << keyframes << " Keyframes] [" << lostTracks << " Lost Tracks] ["
+		<< (seconds > 0 ? frames / seconds : 0) << " fps]" << endl << endlog;
+	startlog << "Detection : [" << cascadeRuns << " Cascade Runs] [" << frames - keyframes << " Tracked Frames]" << endl << endlog;
+	Log::popKey(); // DETECTION
+
+	Log::pushKey(LOG_TIMING);
+	report.log();
+	if (timingReport) writeTimingReport(report, validOutput);
+	Log::popKey(); // TIMING
+
+	Log::pushKey(LOG_GENERATE);
+	Log::print("----------------------------------------\n");
+	Log::print("|   [ +++ Generation Complete +++ ]    |\n");
+	Log::print("----------------------------------------\n\n");
+	Log::popKey(); // GENERATE
+}
+
+// Log "Generating : [count] [positives]" line : The total is not known until the input is exhausted
+inline void logGenerateTitle(int count, int successCount) {
+	Log::pushKey(LOG_GENERATE_INFO);
+	Log::pushKey(LOG_GENERATE_TITLE);
+	startlog << "Generating : [" << count << "] [" << successCount << " Positives]" << endl << endlog;
+	Log::popKey(); // GENERATE_TITLE
+	Log::popKey(); // GENERATE_INFO
+}
+
+// Load, detect and draw one image : Safe to call from worker threads
+std::unique_ptr<Image> generateImage(const std::string& path, std::unique_ptr<Image> workspace) {
+	std::unique_ptr<Image> image = decodeImage(path, std::move(workspace));
+	detectImage(*image);
+	return image;
+}
+
+// Decode stage : Load image from disk, into workspace (a previous Image) when given
+std::unique_ptr<Image> decodeImage(const std::string& path, std::unique_ptr<Image> workspace) {
+	Log::pushKey(LOG_GENERATE_INFO);
+	std::unique_ptr<Image> image = std::move(workspace);
+	if (image) image->loadImage(path);
+	else image = std::make_unique<Image>(path);
+	configureImage(*image);
+	Log::popKey(); // GENERATE_INFO
+	return image;
+}
+
+// Detection Settings of this run : Survive loadImage(), so reused Images only need them once
+void configureImage(Image& image) {
+	image.debugDrawing = !headless && displayLog && (showDebugImage || showCascadeImage);
+	runSettings.apply(image);
+}
+
+// Detect / Render stage : Cascades and drawing
+void detectImage(Image& image) {
+	Log::pushKey(LOG_GENERATE_INFO);
+	image.generateAll();
+	image.drawDebugCascades();
+	if (showDebugImage) image.drawDebugAllCascades(); // No-op without debugDrawing
+	Log::popKey(); // GENERATE_INFO
+}
+
+// Encode stage : Write job image, then delete its input if asked
+void writeImage(const EncodeJob& job, TimingReport& report) {
+	long long writeTime = -1;
+	bool written;
+	{
+		StageTimer timer(writeTime);
+		written = outputEncoder.write(job.writePath, job.image);
+	}
+	report.setStage(job.timingIndex, STAGE_WRITE, writeTime);
+	if (!written) {
+		Log::println("[ERROR] Could not write \"" + job.writePath + "\"", LOG_ERROR);
+		runSummary.fail(job.writePath, "could not write");
+		if (indexActive) processedIndex.fail(job.sourcePath);
+		return;
+	}
+	if (!job.deletePath.empty() && remove(job.deletePath.c_str())) {
+		Log::println("[ERROR] Error Deleting \"" + job.deletePath + "\" from input path", LOG_ERROR);
+		runSummary.fail(job.deletePath, "could not delete");
+	}
+}
+
+// Encode / Write threads : Pop encodeQueue until it is closed and drained (threads = 0 starts none)
+std::vector<std::thread> startEncodeStage(BoundedQueue<EncodeJob>& encodeQueue, TimingReport& report, std::atomic<long long>& encodeBusy, int threads) {
+	std::vector<std::thread> encodeStage;
+	for (int t = 0; t < threads; t++) {
+		encodeStage.emplace_back([&]() {
+			EncodeJob job;
+			while (encodeQueue.pop(job)) {
+				auto start = std::chrono::steady_clock::now();
+				writeImage(job, report);
+				encodeBusy += elapsedMicroseconds(start);
 			}
+		});
+	}
+	return encodeStage;
+}
+
+// Log one pipeline queue : Producer stall = downstream stage is limiting, consumer stall = upstream stage is limiting
+void printQueueStats(const QueueStats& stats) {
+	startlog << "[" << stats.name << "] depth avg " << fixed << setprecision(1) << stats.averageDepth() << " / max " << stats.maxDepth << " (cap " << stats.capacity << ")"
+		<< " : producer stall " << (long long)stats.pushStallMs << " ms : consumer stall " << (long long)stats.popStallMs << " ms"
+		<< (stats.rejected ? " : rejected " + std::to_string(stats.rejected) : "") << endl << endlog;
+	startlog << defaultfloat << setprecision(6);
+}
+
+// Microseconds since start
+inline long long elapsedMicroseconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Display, store and delete for one generated image : Called in input order
+// With an encodeQueue, writes (and the deletes that depend on them) are handed to the encode stage
+void handleResult(Image& image, const std::string& path, const bool& validOutput, int& successCount, TimingReport& report, BoundedQueue<EncodeJob>* encodeQueue) {
+	using namespace std;
+	using namespace cv;
+
+	// Row is added before any write is queued : The encode stage fills in its write time
+	image.timings.positive = image.checkForFaceImage;
+	size_t timingIndex = report.add(image.timings);
+	runSummary.images++;
+
+	// Recorded before any delete : The index hashes the input
+	if (indexActive) {
+		ProcessedIndex::Result result = !image.checkForOriginal ? ProcessedIndex::FAILED
+			: image.checkForFaceImage ? ProcessedIndex::POSITIVE : ProcessedIndex::NEGATIVE;
+		processedIndex.record(path, result);
+	}
+
+	Log::pushKey(LOG_RESULT);
+	// Unreadable input : Nothing to show, store or delete
+	if (!image.checkForOriginal) {
+		Log::println("[ERROR] Could not decode \"" + path + "\"", LOG_ERROR);
+		runSummary.fail(path, "could not decode");
+		Log::popKey(); // RESULT
+		return;
+	}
 
-			if (deleteSuccesses) {
-				if (!remove(path.c_str())) {
-					Log::stream << "Deleting Image : " << endlog;
-					Log::stream << "[-Successful-]" << endl << endlog;
+	// EVALUATE :
+	if (image.checkForFaceImage) {
+		// LOG :
+		if (displayLog) { 
+			if (showDebugImage || showCascadeImage) {
+				imshow(image.name, image.debugImage); keyContinue();
+			}
+			if (showProfileImage) {
+				imshow(image.name, image.faceImage); keyContinue();
+			}
+		}
+		// SAVE :
+		bool queued = false;
+		if (storeImage && validOutput) {
+			startlog << "Storing Image : " << endlog;
+			string writePath = joinPath(outputPath, image.name + outputEncoder.extension(image.ext));
+			if (encodeQueue) {
+				encodeQueue->push(EncodeJob{ writePath, image.faceImage, deleteSuccesses ? path : "", timingIndex, path });
+				queued = true;
+				startlog << "[-Queued-]" << endl << endlog;
+			} else {
+				long long writeTime = -1;
+				bool written;
+				{
+					StageTimer timer(writeTime);
+					written = outputEncoder.write(writePath, image.faceImage);
+				}
+				report.setStage(timingIndex, STAGE_WRITE, writeTime);
+				if (written) {
+					startlog << "[-Successful-]" << endl << endlog;
 				}
 				else {
-					Log::stream << "Error Deleting \"" << path << "\" from input path" << endl << endlog;
+					startlog << "[-Failed-]" << endl << endlog;
+					runSummary.fail(writePath, "could not write");
+					if (indexActive) processedIndex.fail(path);
 				}
 			}
+		} else if (storeImage) {
+			startlog << "Invalid Output Directory [Could not save image]" << endl << endlog;
+		}
 
-			successCount++; // Used for debug printing
-			Log::print("[ === POSITIVE MATCH === ]\n\n");
-
-		} else {
-			// SHOW :
-			if (displayLog && !skipFails) { // Display Logging : (Failed Image)
-				if (showDebugImage || showCascadeImage) {
-					imshow(image.name, image.debugImage); keyContinue();
-				}
-				if (showProfileImage) {
-					imshow(image.name, image.normalized); keyContinue();
-				}
+		if (deleteSuccesses && !queued) {
+			if (!remove(path.c_str())) {
+				startlog << "Deleting Image : " << endlog;
+				startlog << "[-Successful-]" << endl << endlog;
 			}
-			// Save Fail into Fail Folder : ! THERE ARE NO CHECKS SO BE CAREFUL ! // TODO Add checks for fail folder [Low Priority]
-			if (storeFailures) {
-				string failurePath = failPath + image.name + image.ext;
-				imwrite(failurePath, image.normalized);
+			else {
+				startlog << "Error Deleting \"" << path << "\" from input path" << endl << endlog;
+				runSummary.fail(path, "could not delete");
+			}
+		}
 
-				Log::stream << "Storing Fail \"" << image.name << image.ext << "\" in \"" << outputPath << "\"" << endl << endlog;
+		runSummary.positives++;
+		successCount++; // Used for debug printing
+		Log::print("[ === POSITIVE MATCH === ]\n\n");
+
+	} else {
+		// SHOW :
+		if (displayLog && !skipFails) { // Display Logging : (Failed Image)
+			if (showDebugImage || showCascadeImage) {
+				imshow(image.name, image.debugImage); keyContinue();
 			}
-			// Delete Fail From Input
-			if (deleteFailures) {
-				if (!remove(path.c_str())) {
-					Log::stream << "Deleting Negative Image : " << endlog;
-					Log::stream << "[-Successful-]" << endl << endlog;
+			if (showProfileImage) {
+				imshow(image.name, image.normalized); keyContinue();
+			}
+		}
+		// Save Fail into Fail Folder : ! THERE ARE NO CHECKS SO BE CAREFUL ! // TODO Add checks for fail folder [Low Priority]
+		bool queued = false;
+		if (storeFailures) {
+			string failurePath = joinPath(failPath, image.name + outputEncoder.extension(image.ext));
+			if (encodeQueue) {
+				encodeQueue->push(EncodeJob{ failurePath, image.normalized, deleteFailures ? path : "", timingIndex, path });
+				queued = true;
+			} else {
+				long long writeTime = -1;
+				bool written;
+				{
+					StageTimer timer(writeTime);
+					written = outputEncoder.write(failurePath, image.normalized);
 				}
-				else {
-					Log::stream << "Error Deleting \"" << path << "\" from input path" << endl << endlog;
+				report.setStage(timingIndex, STAGE_WRITE, writeTime);
+				if (!written) {
+					runSummary.fail(failurePath, "could not write");
+					if (indexActive) processedIndex.fail(path);
 				}
 			}
-			Log::print("[ === NEGATIVE MATCH === ]\n\n");
 
+			startlog << "Storing Fail \"" << image.name << outputEncoder.extension(image.ext) << "\" in \"" << failPath << "\"" << endl << endlog;
 		}
-		Log::popKey(); // RESULT
+		// Delete Fail From Input
+		if (deleteFailures && !queued) {
+			if (!remove(path.c_str())) {
+				startlog << "Deleting Negative Image : " << endlog;
+				startlog << "[-Successful-]" << endl << endlog;
+			}
+			else {
+				startlog << "Error Deleting \"" << path << "\" from input path" << endl << endlog;
+				runSummary.fail(path, "could not delete");
+			}
+		}
+		Log::print("[ === NEGATIVE MATCH === ]\n\n");
+
 	}
-	Log::pushKey("GENERATE");
-	Log::print("----------------------------------------\n");
-	Log::print("|   [ +++ Generation Complete +++ ]    |\n");
-	Log::print("----------------------------------------\n\n");
-	Log::popKey(); // GENERATE
+	Log::popKey(); // RESULT
+}
 
+// Write report next to the output (working directory without a valid outputPath) : Called once every write has finished
+void writeTimingReport(const TimingReport& report, const bool& validOutput) {
+	std::string directory = validOutput ? outputPath : ".";
+	std::string reportPath = joinPath(directory, timingCsv ? "timings.csv" : "timings.json");
+	bool written = timingCsv ? report.writeCsv(reportPath, joinPath(directory, "timings_summary.csv")) : report.writeJson(reportPath);
+	if (written) {
+		startlog << "Timing Report : \"" << reportPath << "\" [-Successful-]" << endl << endlog;
+	}
+	if (!written) {
+		Log::println("[ERROR] Could not write timing report to \"" + directory + "\"", LOG_ERROR);
+	}
 }
 
 // Container to generate, validate, parse input and output directory.
-void ioHandler(std::vector<std::string>& inFiles, std::vector<std::string>& outFiles, const std::string& inputPath, const std::string& outputPath, bool& validOutput) {
+void ioHandler(std::unique_ptr<InputSource>& input, std::vector<std::string>& outFiles, const std::string& inputPath, const std::string& outputPath, bool& validOutput) {
 
 	// Pretty Print Title :
-	Log::pushKey("TITLE");
+	Log::pushKey(LOG_TITLE);
 	Log::println("----------------------------------------");
 	Log::println("|  [ =-= HEVE STARVEY GENERATOR =-= ]  |");
 	Log::println("----------------------------------------");
@@ -238,49 +1114,58 @@ void ioHandler(std::vector<std::string>& inFiles, std::vector<std::string>& outF
 	// Get output first to check for duplicates :
 	generateOutputFileList(outFiles, outputPath, validOutput);
 
-	Log::pushKey("VALIDATE_INPUT");
-	generateInputFileList(inFiles, outFiles, inputPath);
-	Log::popKey();
-
-	Log::pushKey("INPUT_LIST");
-	printFileList(inFiles, "Input File List", inputPath);
+	Log::pushKey(LOG_VALIDATE_INPUT);
+	if (isVideoInput(inputPath)) {
+		// Video : Read by generateVideo() (input stays empty), the index and duplicate checks do not apply
+		Log::print("Validating Input : [Video]\n----------------------------------------\n");
+	}
+	else {
+		indexActive = loadIndex(validOutput);
+		input = generateInputSource(outFiles, inputPath);
+	}
 	Log::popKey();
 
-	Log::pushKey("OUTPUT_LIST");
+	Log::pushKey(LOG_OUTPUT_LIST);
 	printFileList(outFiles, "Output File List", outputPath);
 	Log::popKey();
 }
 
-// Parse valid file paths from directory OR file input
-inline void generateInputFileList(std::vector <std::string>& fileList, const std::vector <std::string>& outFiles, const std::string path) {
-	using namespace cv;
+// Open inputPath (file OR directory) for streaming : Paths are validated as generation reads them
+std::unique_ptr<InputSource> generateInputSource(const std::vector <std::string>& outFiles, const std::string path) {
 	using namespace std;
 
-	// Validate Path :
-	bool isFile = path.rfind('.') < path.npos && path.rfind('.') != 0;
-	bool isDirectory = path.find('\\') < path.npos;
-	bool ifExists = exists(path);
-	if (isFile && ifExists && !isDirectory) { 
-		// Input is valid file :
-		fileList.push_back(path);
-	} else if (isDirectory && ifExists && !isFile) { 
-		// Input is valid directory :
-		for (const auto& dirItem : fs::directory_iterator(path)) {
-			string pathName = dirItem.path().string();
-			fileList.push_back(pathName);
-		}
-	} else { 
-		// Input Path is invalid :
-		Log::println("[ERROR] Enter Valid Path", "ERROR");
-		//cout << "Enter Valid Path" << endl;
-		return;
+	// Get output file name list (w/o path and ext) to compare for checking duplicates
+	// Indexed inputs are decided by the index : The name check only covers paths it has no entry for
+	bool skipIndexed = indexActive && !overrideDuplicates;
+	bool checkNames = !overrideDuplicates;
+	unordered_set<string> outputNames;
+	if (checkNames) {
+		for (const string& path : outFiles) outputNames.insert(fileStem(path));
 	}
 
-	// Get output file name list (w/o path and ext) to compare for checking duplicates
-	vector<string> outputNames;
-	for (string path : outFiles) {
-		string oName = path.substr(path.rfind('\\') + 1, path.rfind('.') - path.rfind('\\') - 1);
-		outputNames.push_back(oName);
+	// Runs on whichever thread reads the input : Indexed files are skipped on the directory entry's size / mtime (no extra stat)
+	InputSource::Filter skip = [=, outputNames = move(outputNames)](const fs::directory_entry& entry) {
+		if (skipIndexed && processedIndex.unchanged(entry)) {
+			inputSkips.unchanged++;
+			return true;
+		}
+		string filePath = entry.path().string();
+		if (checkNames && !(indexActive && processedIndex.contains(filePath)) && outputNames.count(fileStem(filePath))) {
+			// Bootstrap : Recorded as processed, so later runs skip it through the index
+			if (indexActive) processedIndex.record(filePath, ProcessedIndex::POSITIVE);
+			inputSkips.duplicates++;
+			return true;
+		}
+		return false;
+	};
+	unique_ptr<InputSource> input = make_unique<InputSource>(path, recursiveInput, skip);
+
+	// Validate Path :
+	if (!input->isValid()) {
+		// Input Path is invalid :
+		Log::println("[ERROR] Enter Valid Path", LOG_ERROR);
+		runSummary.setupFailed = true;
+		return input;
 	}
 
 	if (!overrideDuplicates) {
@@ -288,59 +1173,35 @@ inline void generateInputFileList(std::vector <std::string>& fileList, const std
 	} else {
 		Log::print("Validating Input : [Keep Duplicates] ");
 	}
+	if (recursiveInput && input->isDirectory()) Log::print("[Recursive] ");
+	Log::print("\n----------------------------------------\n");
+	return input;
+}
 
-	int duplicateCount = 0;
-	// Validate Files in Path :
-	for (auto path = fileList.begin(); path != fileList.end();) {
-		// Get file extension :
-		int extIndex = path->rfind(".");
-		if (extIndex != path->npos) {
-			// Make fExtension lowercase :
-			transform(path->begin() + extIndex, path->end(), path->begin() + extIndex, ::tolower);
-			if (validateExtension(*path)) {
-				// Input Path(i) is a valid image files
-				bool isDuplicate = false;
-				string iName = path->substr(path->rfind('\\') + 1, path->rfind('.') - path->rfind('\\') - 1);
-				if (!overrideDuplicates) {
-					for (string oName : outputNames) {
-						if (oName == iName) {
-							isDuplicate = true;
-							duplicateCount++;
-							break;
-						}
-					}
-				}
-				// Test for Duplicate
-				if (!overrideDuplicates && isDuplicate) {
-					// Print Handling :
-					
-					// If duplicate and no override : Path is removed from valid list
-					path = fileList.erase(path);
-					continue;
-
-				} else {
-					// Path is Valid
-					path++;
-					continue;
-				}
-			}
-			else {
-				// Invalid Extension (Invalid Path is Removed)
-				path = fileList.erase(path);
-				continue;
-			}
-		}
-		else {
-			// No Extension (Invalid Path is Removed)
-			path = fileList.erase(path);
-			continue;
-		}
+// Input totals once generation has read all of it : Index entries for inputs that are gone are dropped here
+void logInputSummary(const InputSource& input) {
+	using namespace std;
+	const InputSource::Counts& counts = input.counts();
+
+	Log::pushKey(LOG_VALIDATE_INPUT);
+	Log::print("Validated Input : ");
+	if (indexActive && !overrideDuplicates) {
+		startlog << "[" << inputSkips.unchanged << " Unchanged] " << endlog;
+	}
+	if (inputSkips.duplicates) {
+		startlog << "[" << inputSkips.duplicates << " Duplicates] " << endlog;
 	}
+	startlog << "[" << counts.invalid << " Invalid] [" << counts.valid << " Valid]" << endl << endlog;
+	Log::popKey();
 
-	// Print Handling for Exceptions : key=VALIDATE_INPUT
-	if (!overrideDuplicates) Log::stream << "[" << duplicateCount << " Duplicates] " << endlog;
-	Log::stream << "[" << fileList.size() << " Valid] " << endlog;
-	Log::print("\n----------------------------------------\n");
+	if (!input.error().empty()) {
+		// Walk stopped early : Unlisted files may still exist, so nothing is pruned
+		Log::println("[ERROR] Could not finish reading \"" + inputPath + "\" : " + input.error(), LOG_ERROR);
+		runSummary.fail(inputPath, "could not list");
+	}
+	else if (indexActive && !overrideDuplicates && input.isDirectory()) {
+		processedIndex.prune(inputPath, recursiveInput);
+	}
 }
 
 // Parse valid file paths from directory input
@@ -352,38 +1213,19 @@ inline void generateOutputFileList(std::vector <std::string>& fileList, const st
 	validOutput = true;
 
 	// Validate Output Path :
-	bool isFile = path.find(".") < path.npos;
-	bool isDirectory = path.find("\\") < path.npos;
+	error_code error;
+	bool isDirectory = fs::is_directory(path, error);
 	bool ifExists = exists(path);
 	if (isDirectory && ifExists) {
-		// Only directory is valid for output
-		for (const auto& dirItem : fs::directory_iterator(path)) {
-			string pathName = dirItem.path().string();
-			fileList.push_back(pathName);
-		}
+		// Only directory is valid for output : Images are kept as they are listed (sub folders and other files never enter the list)
+		InputSource output(path);
+		string pathName;
+		while (output.next(pathName)) fileList.push_back(pathName);
 	} else {
-		Log::print("[ERROR] Invalid Output Path\n", "ERROR");
+		Log::print("[ERROR] Invalid Output Path\n", LOG_ERROR);
 		validOutput = false;
 		return;
 	}
-
-	// Validate Files in Path :
-	for (auto path = fileList.begin(); path != fileList.end();) {
-		// Get file extension :
-		int extIndex = path->rfind(".");
-		if (extIndex != path->npos) {
-			// Make fExtension lowercase :
-			transform(path->begin() + extIndex, path->end(), path->begin() + extIndex, ::tolower);
-			if (validateExtension(*path)) {
-				path++;
-				continue;
-			} else {
-				// Remove items without file extension :
-				path = fileList.erase(path);
-				continue;
-			}
-		}
-	}
 }
 
 /* ------------------------------------- Helper Functions ------------------------------------- */
@@ -395,7 +1237,7 @@ void printFileList(const std::vector<std::string>& fileList, std::string name, s
 	if (name.empty()) {
 		name = "File List";
 	}
-	Log::stream << name << " : " << path << endlog;
+	startlog << name << " : " << path << endlog;
 
 	if (fileList.empty()) {
 		Log::print(" : [EMPTY]\n");
@@ -405,23 +1247,23 @@ void printFileList(const std::vector<std::string>& fileList, std::string name, s
 	}
 
 	for (string file : fileList) {
-		Log::stream << file << endl << endlog;
+		startlog << file << endl << endlog;
 	}
 	Log::print("----------------------------------------\n");
 }
 
 // Display and Log output folder
 inline void displayOutput(const std::vector<string>& outFiles) {
-	if (!showOutput) return; // Setting
+	if (!showOutput || headless) return; // Setting
 
-	Log::stream << "----------------------------------------" << endl << endlog;
-	Log::stream << "|     [ === Positive Matches === ]     |" << endl << endlog;
-	Log::stream << "----------------------------------------" << endl << endlog;
+	startlog << "----------------------------------------" << endl << endlog;
+	startlog << "|     [ === Positive Matches === ]     |" << endl << endlog;
+	startlog << "----------------------------------------" << endl << endlog;
 	for (string path : outFiles) {
-		string name = path.substr(path.rfind('\\') + 1, path.rfind('.') - path.rfind('\\') - 1);
+		string name = fileStem(path);
 		Mat outImage = imread(path);
 		imshow(name, outImage);
-		Log::stream << "[Success] : " << name << endl << endlog;
+		startlog << "[Success] : " << name << endl << endlog;
 		keyContinue();
 	}
 	Log::print("----------------------------------------\n");
@@ -429,31 +1271,34 @@ inline void displayOutput(const std::vector<string>& outFiles) {
 
 // Wait for key press and clear windows on key event
 inline void keyContinue() {
+	if (headless) return; // Nobody to press a key
+	Log::flush(); // Everything about this image is on the console before waiting
 	cv::waitKey();
 	cv::destroyAllWindows();
 }
 
-// Check if file exists in directory
-inline bool exists(const std::string& name) {
-	// Source : https://stackoverflow.com/questions/12774207/fastest-way-to-check-if-a-file-exist-using-standard-c-c11-14-17-c
-	struct stat buffer;
-	return (stat(name.c_str(), &buffer) == 0);
+// Video file or numbered frame sequence ("frame_%04d.png" : VideoCapture reads it as a video)
+inline bool isVideoInput(const std::string& path) {
+	if (path.find('%') != std::string::npos) return true;
+	std::string ext = fs::path(path).extension().string();
+	transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".mp4" || ext == ".avi" || ext == ".mov" || ext == ".mkv" || ext == ".webm" || ext == ".m4v";
 }
 
-// Check if path has valid image extension (.png, .jpg, .jpeg)
-inline bool validateExtension(const std::string& path) {
-	if (path.ends_with(".png")) {
-		return true;
-	}
-	else if (path.ends_with(".jpg")) {
-		return true;
-	}
-	else if (path.ends_with(".jpeg")) {
-		return true;
-	}
-	else {
-		return false;
-	}
+// File name without folder or extension (either separator on Windows)
+inline std::string fileStem(const std::string& path) {
+	return fs::path(path).stem().string();
+}
+
+// directory / file : Works whether or not directory ends with a separator
+inline std::string joinPath(const std::string& directory, const std::string& file) {
+	return (fs::path(directory) / file).string();
+}
+
+// Check if file exists in directory
+inline bool exists(const std::string& name) {
+	std::error_code error;
+	return fs::exists(name, error);
 }
 
 /* ------------------------------------ Fuck you --------------------------------------- */
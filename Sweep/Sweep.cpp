@@ -0,0 +1,331 @@
+/* ------------------------------ Steve Harvey Image Generator ------------------------------ */
+/* ------------------------------------- Parameter Sweep ------------------------------------- */
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/utils/logger.hpp>
+#include <filesystem>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include "Image.h"
+#include "StageTimings.h"
+#include "RunSettings.h"
+#include "InputSource.h"
+#include "Log.h"
+namespace fs = std::filesystem; // Requires C++17
+
+#define endlog Log::printStream()
+
+/* ---------------------------------------- Headers ---------------------------------------- */
+
+// Cascade::settings() arguments
+struct CascadeSettings {
+	double scaleFactor = 1.1;
+	int minNeighbors = 3;
+	int minSize = 0;			// Square
+};
+
+// Settings for face, eye, anime face, anime eye (Image cascade order)
+struct SweepConfig {
+	CascadeSettings cascades[4];
+};
+
+// Score of one configuration over the labelled corpus
+struct SweepResult {
+	SweepConfig config;
+	double detectMs = 0;		// Summed cascade time over the corpus (fastest repeat)
+	int truePositives = 0;		// Output image matched
+	int falseNegatives = 0;		// Output image missed
+	int falsePositives = 0;		// Failure image matched
+	int trueNegatives = 0;		// Failure image rejected
+	bool frontier = false;
+
+	double accuracy() const {
+		int total = truePositives + falseNegatives + falsePositives + trueNegatives;
+		return total ? (double)(truePositives + trueNegatives) / total : 0;
+	}
+};
+
+// Corpus image decoded, normalized and grayscaled once : Only cascades and the face check run per configuration
+struct LabelledImage {
+	std::unique_ptr<Image> image;
+	bool expected = false;		// Positive match expected
+};
+
+bool parseArguments(int argc, char** argv, int& repeats, std::string& csvPath, bool& compiled);
+void loadCorpus(const std::string& directory, bool expected, std::vector<LabelledImage>& corpus);
+std::vector<SweepConfig> generateConfigs(const SweepConfig& defaults);
+SweepResult scoreConfig(const SweepConfig& config, std::vector<LabelledImage>& corpus, int repeats);
+void markFrontier(std::vector<SweepResult>& results);
+bool writeResults(const std::string& path, const std::vector<SweepResult>& results);
+std::string describeConfig(const SweepConfig& config, const SweepConfig& defaults);
+inline Cascade* imageCascade(Image& image, int index);
+
+/* ---------------------------------------- SETTINGS ---------------------------------------- */
+
+// Run from the OpenCVProject folder : Cascade paths in Image are relative to it
+const std::string positivePath = "./Resources/Output/";		// Expected positive matches
+const std::string negativePath = "./Resources/Failures/";	// Expected negative matches
+
+// Values tried for each cascade : One cascade is swept at a time, the others keep Image's defaults
+const std::vector<double> scaleFactors = { 1.05, 1.1, 1.2, 1.3 };
+const std::vector<int> minNeighbors = { 2, 3, 4, 5, 6, 8 };
+const std::vector<int> minSizes = { 20, 25, 40, 60 };
+
+// Same decode / detection settings main.cpp ships with
+const RunSettings runSettings;
+
+const char* cascadeNames[] = { "face", "eye", "anime_face", "anime_eye" };
+
+/* ---------------------------------------- Main ---------------------------------------- */
+
+/// <summary>
+/// Sweep Cascade::settings (scaleFactor, minNeighbors, minSize) of the four cascades over the labelled corpus,
+/// timing detection and scoring matches for each configuration, then report the time vs accuracy Pareto frontier.
+/// Exit code : 0 = ok, 2 = bad arguments / empty corpus / unwritable results
+/// </summary>
+int main(int argc, char** argv) {
+	using namespace std;
+	using namespace cv;
+	utils::logging::setLogLevel(utils::logging::LogLevel::LOG_LEVEL_ERROR);
+
+	int repeats = 1;
+	string csvPath = "sweep.csv";
+	bool compiled = false;
+	if (!parseArguments(argc, argv, repeats, csvPath, compiled)) return 2;
+
+	// Only errors and the report : Image's own logging would be timed otherwise
+	for (int channel = 0; channel < LOG_CHANNEL_COUNT; channel++) Log::blacklist((LogChannel)channel);
+	Log::whitelist(LOG_DEFAULT);
+	Log::whitelist(LOG_ERROR);
+
+	runSettings.applyProcess();
+	Cascade::useCompiled = compiled;
+
+	vector<LabelledImage> corpus;
+	loadCorpus(positivePath, true, corpus);
+	loadCorpus(negativePath, false, corpus);
+	if (corpus.empty()) {
+		Log::println("[ERROR] No images in corpus", LOG_ERROR);
+		Log::stop();
+		return 2;
+	}
+
+	// Defaults are whatever Image's constructor sets
+	SweepConfig defaults;
+	for (int c = 0; c < 4; c++) {
+		Cascade* cascade = imageCascade(*corpus.front().image, c);
+		defaults.cascades[c] = CascadeSettings{ cascade->scaleFactor, cascade->minNeighbors, cascade->minSize.width };
+	}
+
+	vector<SweepConfig> configs = generateConfigs(defaults);
+	size_t positives = count_if(corpus.begin(), corpus.end(), [](const LabelledImage& item) { return item.expected; });
+	startlog << "Sweep : [" << configs.size() << " Configurations] [" << positives << " Positives] [" << corpus.size() - positives << " Negatives] ["
+		<< repeats << " Repeats] [" << (compiled ? "Compiled" : "XML") << " Cascades]" << endl << endlog;
+	Log::print("----------------------------------------\n");
+
+	// Warm up : Loads every classifier before anything is timed
+	scoreConfig(defaults, corpus, 1);
+
+	vector<SweepResult> results;
+	for (size_t i = 0; i < configs.size(); i++) {
+		results.push_back(scoreConfig(configs[i], corpus, repeats));
+		if ((i + 1) % 10 == 0 || i + 1 == configs.size()) {
+			startlog << "Scored : [" << i + 1 << " / " << configs.size() << "]" << endl << endlog;
+		}
+	}
+	markFrontier(results);
+
+	// Frontier, fastest first
+	vector<const SweepResult*> frontier;
+	for (const SweepResult& result : results) {
+		if (result.frontier) frontier.push_back(&result);
+	}
+	sort(frontier.begin(), frontier.end(), [](const SweepResult* a, const SweepResult* b) { return a->detectMs < b->detectMs; });
+
+	Log::print("----------------------------------------\n");
+	startlog << "Pareto Frontier : Detection time vs accuracy" << endl << endlog;
+	startlog << fixed << setprecision(1);
+	for (const SweepResult* result : frontier) {
+		startlog << "[" << result->detectMs << " ms] [" << result->accuracy() * 100 << "% Accuracy] [TP " << result->truePositives << " FN " << result->falseNegatives
+			<< " FP " << result->falsePositives << " TN " << result->trueNegatives << "] " << describeConfig(result->config, defaults) << endl << endlog;
+	}
+	startlog << defaultfloat << setprecision(6);
+	Log::print("----------------------------------------\n");
+
+	int result = 0;
+	if (writeResults(csvPath, results)) {
+		startlog << "Results : \"" << csvPath << "\"" << endl << endlog;
+	}
+	else {
+		Log::println("[ERROR] Could not write \"" + csvPath + "\"", LOG_ERROR);
+		result = 2;
+	}
+	Log::stop();
+	return result;
+}
+
+/* ---------------------------------------- Functions ---------------------------------------- */
+
+// --repeats N --csv PATH --compiled
+bool parseArguments(int argc, char** argv, int& repeats, std::string& csvPath, bool& compiled) {
+	using namespace std;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+		if (arg == "--compiled") compiled = true;
+		else if (arg == "--repeats" && hasValue) repeats = max(1, atoi(argv[++i]));
+		else if (arg == "--csv" && hasValue) csvPath = argv[++i];
+		else {
+			Log::println("[ERROR] Unknown argument \"" + arg + "\"", LOG_ERROR);
+			Log::println("Usage : Sweep [--repeats N] [--csv PATH] [--compiled]", LOG_ERROR);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Decode, normalize and grayscale every image in directory once
+void loadCorpus(const std::string& directory, bool expected, std::vector<LabelledImage>& corpus) {
+	using namespace std;
+	vector<string> files;
+	error_code error;
+	for (const auto& dirItem : fs::directory_iterator(directory, error)) {
+		string pathName = dirItem.path().string();
+		if (dirItem.is_regular_file() && InputSource::validExtension(pathName)) files.push_back(pathName);
+	}
+	if (error) Log::println("[ERROR] Could not read corpus directory \"" + directory + "\"", LOG_ERROR);
+	sort(files.begin(), files.end());
+
+	for (const string& path : files) {
+		LabelledImage item;
+		item.image = make_unique<Image>(path);
+		item.image->debugDrawing = false;
+		runSettings.apply(*item.image);
+		item.image->generateNormalizedImage();
+		item.image->generateGrayscaleImage();
+		if (!item.image->checkForGrayscale) {
+			Log::println("[ERROR] Could not decode \"" + path + "\"", LOG_ERROR);
+			continue;
+		}
+		item.expected = expected;
+		corpus.push_back(move(item));
+	}
+}
+
+// Defaults, then every grid value for one cascade at a time (duplicates of the defaults skipped)
+std::vector<SweepConfig> generateConfigs(const SweepConfig& defaults) {
+	std::vector<SweepConfig> configs = { defaults };
+	for (int c = 0; c < 4; c++) {
+		for (double scaleFactor : scaleFactors) {
+			for (int neighbors : minNeighbors) {
+				for (int minSize : minSizes) {
+					const CascadeSettings& base = defaults.cascades[c];
+					if (scaleFactor == base.scaleFactor && neighbors == base.minNeighbors && minSize == base.minSize) continue;
+					SweepConfig config = defaults;
+					config.cascades[c] = CascadeSettings{ scaleFactor, neighbors, minSize };
+					configs.push_back(config);
+				}
+			}
+		}
+	}
+	return configs;
+}
+
+/// <summary>
+/// Run the cascades and the face check over the corpus with config's settings.
+/// Time is the sum of the four cascades' detect time (Image::timings), the fastest of repeats runs.
+/// </summary>
+SweepResult scoreConfig(const SweepConfig& config, std::vector<LabelledImage>& corpus, int repeats) {
+	SweepResult result;
+	result.config = config;
+	result.detectMs = -1;
+
+	for (int run = 0; run < repeats; run++) {
+		long long microseconds = 0;
+		int truePositives = 0, falseNegatives = 0, falsePositives = 0, trueNegatives = 0;
+		for (LabelledImage& item : corpus) {
+			Image& image = *item.image;
+			for (int c = 0; c < 4; c++) {
+				const CascadeSettings& settings = config.cascades[c];
+				Cascade* cascade = imageCascade(image, c);
+				cascade->settings(settings.scaleFactor, settings.minNeighbors, cv::Size(settings.minSize, settings.minSize));
+				cascade->detectMicroseconds = -1;
+			}
+			image.checkForFaceImage = false; // generateFaceImage() only ever sets it
+
+			image.generateCascades();
+			image.generateFaceImage();
+			for (int stage = STAGE_FACE_CASCADE; stage <= STAGE_ANIME_EYE_CASCADE; stage++) {
+				microseconds += std::max(image.timings.microseconds[stage], 0LL);
+			}
+
+			if (item.expected) (image.checkForFaceImage ? truePositives : falseNegatives)++;
+			else (image.checkForFaceImage ? falsePositives : trueNegatives)++;
+		}
+
+		double detectMs = microseconds / 1000.0;
+		if (result.detectMs < 0 || detectMs < result.detectMs) result.detectMs = detectMs;
+		result.truePositives = truePositives;
+		result.falseNegatives = falseNegatives;
+		result.falsePositives = falsePositives;
+		result.trueNegatives = trueNegatives;
+	}
+	return result;
+}
+
+// Frontier : No other configuration is at least as fast and as accurate, and strictly better in one
+void markFrontier(std::vector<SweepResult>& results) {
+	for (SweepResult& result : results) {
+		result.frontier = true;
+		for (const SweepResult& other : results) {
+			bool noWorse = other.detectMs <= result.detectMs && other.accuracy() >= result.accuracy();
+			bool better = other.detectMs < result.detectMs || other.accuracy() > result.accuracy();
+			if (noWorse && better) {
+				result.frontier = false;
+				break;
+			}
+		}
+	}
+}
+
+// One row per configuration : Settings of all four cascades, time, confusion counts, accuracy and frontier flag
+bool writeResults(const std::string& path, const std::vector<SweepResult>& results) {
+	std::ofstream out(path);
+	if (!out) return false;
+	for (const char* name : cascadeNames) out << name << "_scale," << name << "_neighbors," << name << "_min_size,";
+	out << "detect_ms,true_positives,false_negatives,false_positives,true_negatives,accuracy,frontier\n";
+	for (const SweepResult& result : results) {
+		for (const CascadeSettings& settings : result.config.cascades) {
+			out << settings.scaleFactor << "," << settings.minNeighbors << "," << settings.minSize << ",";
+		}
+		out << std::fixed << std::setprecision(3) << result.detectMs << std::defaultfloat << std::setprecision(6) << ","
+			<< result.truePositives << "," << result.falseNegatives << "," << result.falsePositives << "," << result.trueNegatives << ","
+			<< result.accuracy() << "," << (result.frontier ? 1 : 0) << "\n";
+	}
+	return (bool)out;
+}
+
+// Only the cascades that differ from the defaults, ex: "eye (1.2, 4, 25)"
+std::string describeConfig(const SweepConfig& config, const SweepConfig& defaults) {
+	std::stringstream description;
+	for (int c = 0; c < 4; c++) {
+		const CascadeSettings& settings = config.cascades[c];
+		const CascadeSettings& base = defaults.cascades[c];
+		if (settings.scaleFactor == base.scaleFactor && settings.minNeighbors == base.minNeighbors && settings.minSize == base.minSize) continue;
+		description << cascadeNames[c] << " (" << settings.scaleFactor << ", " << settings.minNeighbors << ", " << settings.minSize << ") ";
+	}
+	return description.str().empty() ? "defaults" : description.str();
+}
+
+// Cascade by sweep index (face, eye, anime face, anime eye)
+inline Cascade* imageCascade(Image& image, int index) {
+	Cascade* cascades[] = { &image.faceCascade, &image.eyeCascade, &image.animeFaceCascade, &image.animeEyeCascade };
+	return cascades[index];
+}
@@ -0,0 +1,255 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include "Tests.h"
+#include "Image.h"
+#include "Cascade.h"
+#include "CompiledCascade.h"
+#include "InputSource.h"
+#include "Log.h"
+
+#define endlog Log::printStream()
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+static const double openCVTolerance = 0.05;    // Same default as the generator's verifyOpenCV check
+
+// Bundled images (Resources/Input and Resources/Failures) normalized and grayscaled the way Image detects on them
+static vector<Mat> corpusGrayscale() {
+	vector<Mat> images;
+	for (const char* folder : { "./Resources/Input", "./Resources/Failures" }) {
+		error_code error;
+		for (const auto& entry : fs::directory_iterator(folder, error)) {
+			string path = entry.path().string();
+			if (!InputSource::validExtension(path)) continue;
+			Image image(path);
+			if (!image.checkForOriginal) continue;
+			image.generateNormalizedImage();
+			image.generateGrayscaleImage();
+			images.push_back(image.grayscale);
+		}
+	}
+	return images;
+}
+
+// One to one matches at IoU >= Cascade::verifyOverlap : Each reference rect takes the unmatched found rect it overlaps most
+static int matchRects(const vector<Rect>& reference, const vector<Rect>& found) {
+	vector<bool> used(found.size(), false);
+	int matched = 0;
+	for (const Rect& expected : reference) {
+		int best = -1;
+		double bestOverlap = 0;
+		for (size_t i = 0; i < found.size(); i++) {
+			if (used[i]) continue;
+			double overlap = (expected & found[i]).area();
+			double iou = overlap / (expected.area() + found[i].area() - overlap);
+			if (iou > bestOverlap) {
+				bestOverlap = iou;
+				best = (int)i;
+			}
+		}
+		if (best >= 0 && bestOverlap >= Cascade::verifyOverlap) {
+			used[best] = true;
+			matched++;
+		}
+	}
+	return matched;
+}
+
+static vector<char> readBytes(const string& path) {
+	ifstream file(path, ios::binary);
+	return vector<char>((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+}
+
+static void writeBytes(const string& path, const vector<char>& bytes) {
+	ofstream file(path, ios::binary | ios::trunc);
+	file.write(bytes.data(), (streamsize)bytes.size());
+}
+
+/// <summary>
+/// Every bundled cascade (stumps and trees) over every bundled image : The compiled evaluator's rects match
+/// CascadeClassifier::detectMultiScale's within openCVTolerance, counted the way the generator's verifyOpenCV summary counts them.
+/// </summary>
+void testCompiledMatchesOpenCV() {
+	vector<Mat> images = corpusGrayscale();
+	CHECK(!images.empty());
+
+	// The generator's four cascades with their settings, plus the bundled alternatives with the matching ones
+	Image settings;
+	vector<Cascade> cascades = { settings.faceCascade, settings.eyeCascade, settings.animeFaceCascade, settings.animeEyeCascade };
+	for (const char* path : { "./Resources/HaarCascade/haarcascade_frontalface_tree_adaboost.xml", "./Resources/HaarCascade/haarcascade_frontalface_tree_alt.xml" }) {
+		cascades.push_back(Cascade(path));
+		cascades.back().settings(settings.faceCascade.scaleFactor, settings.faceCascade.minNeighbors, settings.faceCascade.minSize);
+	}
+	cascades.push_back(Cascade("./Resources/HaarCascade/haarcascade_eyes.xml"));
+	cascades.back().settings(settings.eyeCascade.scaleFactor, settings.eyeCascade.minNeighbors, settings.eyeCascade.minSize);
+
+	for (Cascade& cascade : cascades) {
+		CompiledCascade* compiled = cascade.compiledClassifier();
+		if (!CHECK(compiled != nullptr)) continue;
+
+		long long reference = 0, found = 0, matched = 0;
+		for (const Mat& grayscale : images) {
+			vector<Rect> expected, rects;
+			cascade.classifier().detectMultiScale(grayscale, expected, cascade.scaleFactor, cascade.minNeighbors, 0, cascade.minSize);
+			compiled->detectMultiScale(grayscale, rects, cascade.scaleFactor, cascade.minNeighbors, cascade.minSize);
+			reference += expected.size();
+			found += rects.size();
+			matched += matchRects(expected, rects);
+		}
+		long long unmatched = (reference - matched) + (found - matched);
+		double mismatchRate = (reference + found > 0) ? (double)unmatched / max(reference, found) : 0;
+		if (!CHECK(mismatchRate <= openCVTolerance)) {
+			startlog << "    " << cascade.path << " : " << reference << " OpenCV / " << found << " compiled / " << matched << " matched" << endl << endlog;
+		}
+	}
+}
+
+/// <summary>
+/// A damaged .hcc (flipped payload byte, old version, wrong magic, truncated, stale source stamp) is never used :
+/// load() rejects it and writes the same binary a clean compile produces.
+/// </summary>
+void testCompiledRejectsBadBinary() {
+	string folder = Tests::tempFolder("compiled_binary");
+	string xmlPath = (fs::path(folder) / "haarcascade_eyes.xml").string();
+	fs::copy_file("./Resources/HaarCascade/haarcascade_eyes.xml", xmlPath);
+	string binaryPath = CompiledCascade::binaryPathFor(xmlPath);
+
+	vector<char> pristine;
+	{
+		shared_ptr<CompiledCascade> cascade = CompiledCascade::load(xmlPath);
+		if (!CHECK(cascade != nullptr)) return;
+		pristine = readBytes(binaryPath);
+	} // Unmapped before the file is rewritten
+	if (!CHECK(pristine.size() > sizeof(CompiledCascadeHeader))) return;
+
+	auto header = [](vector<char>& bytes) { return (CompiledCascadeHeader*)bytes.data(); };
+	auto recovers = [&](const vector<char>& damaged) {
+		writeBytes(binaryPath, damaged);
+		shared_ptr<CompiledCascade> cascade = CompiledCascade::load(xmlPath);
+		return cascade != nullptr && cascade->header != nullptr && readBytes(binaryPath) == pristine;
+	};
+
+	vector<char> damaged = pristine;
+	damaged.back() ^= 0x5A;
+	CHECK(recovers(damaged));				// Checksum
+
+	damaged = pristine;
+	header(damaged)->version = CompiledCascade::VERSION - 1;
+	CHECK(recovers(damaged));				// Old version
+
+	damaged = pristine;
+	header(damaged)->magic = 0;
+	CHECK(recovers(damaged));
+
+	damaged = pristine;
+	damaged.resize(damaged.size() / 2);
+	CHECK(recovers(damaged));				// Sizes in the header do not add up
+
+	damaged = pristine;
+	header(damaged)->sourceTime += 1;
+	CHECK(recovers(damaged));				// Compiled from another version of the XML
+}
+
+// Same stage sums : Both NaN (stage never reached) or equal
+static bool sameSums(const vector<double>& expected, const vector<double>& found) {
+	if (expected.size() != found.size()) return false;
+	for (size_t i = 0; i < expected.size(); i++) {
+		if (isnan(expected[i]) != isnan(found[i])) return false;
+		if (!isnan(expected[i]) && expected[i] != found[i]) return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Each SIMD evaluator this CPU has (SSE4.1, AVX2), forced in turn, against the scalar path on the same integral images :
+/// Stage sums of every window in a sample of rows, raw candidates of every level and grouped rects all match exactly.
+/// </summary>
+void testCompiledSimdMatchesScalar() {
+	vector<Mat> images = corpusGrayscale();
+	CHECK(!images.empty());
+
+	const CompiledCascade::SimdLevel simd = CompiledCascade::simd;
+	const CompiledCascade::SimdLevel available = CompiledCascade::detectSimd();
+	if (available == CompiledCascade::SIMD_NONE) {
+		startlog << "    No SSE4.1 / AVX2 on this CPU : Nothing to compare" << endl << endlog;
+		return;
+	}
+	if (available < CompiledCascade::SIMD_AVX2) startlog << "    No AVX2 on this CPU : Only SSE4.1 checked" << endl << endlog;
+
+	Image settings;
+	vector<Cascade> cascades = { settings.faceCascade, settings.eyeCascade, settings.animeFaceCascade, settings.animeEyeCascade };
+	cascades.push_back(Cascade("./Resources/HaarCascade/haarcascade_eyes.xml"));
+	cascades.back().settings(settings.eyeCascade.scaleFactor, settings.eyeCascade.minNeighbors, settings.eyeCascade.minSize);
+
+	int stumpCascades = 0;
+	for (Cascade& cascade : cascades) {
+		CompiledCascade* compiled = cascade.compiledClassifier();
+		if (!CHECK(compiled != nullptr)) continue;
+
+		// Only stump HAAR cascades have SIMD evaluators
+		PyramidLevel probe;
+		CompiledCascade::buildLevel(images.front(), 1, compiled->needsSquares(), compiled->needsTilted(), probe);
+		if (compiled->stageSums(probe, 0, vector<int32_t>(4, 0), CompiledCascade::SIMD_SSE41).empty()) continue;
+		stumpCascades++;
+
+		long long sampledWindows = 0, sumMismatches = 0, levelMismatches = 0, rectMismatches = 0;
+		for (const Mat& grayscale : images) {
+			vector<Rect> scalarRects;
+			vector<vector<Rect>> simdRects(available + 1);
+			for (double factor : compiled->scaleFactors(grayscale.size(), cascade.scaleFactor, cascade.minSize)) {
+				PyramidLevel level;
+				CompiledCascade::buildLevel(grayscale, factor, compiled->needsSquares(), compiled->needsTilted(), level);
+				const Size window = compiled->windowSize();
+
+				CompiledCascade::simd = CompiledCascade::SIMD_NONE;
+				vector<Rect> scalarCandidates;
+				compiled->detectAtScale(level, scalarCandidates);
+				scalarRects.insert(scalarRects.end(), scalarCandidates.begin(), scalarCandidates.end());
+
+				for (int path = CompiledCascade::SIMD_SSE41; path <= available; path++) {
+					CompiledCascade::simd = (CompiledCascade::SimdLevel)path;
+					vector<Rect> candidates;
+					compiled->detectAtScale(level, candidates);
+					if (candidates != scalarCandidates) levelMismatches++;
+					simdRects[path].insert(simdRects[path].end(), candidates.begin(), candidates.end());
+
+					// Stage sums : Every 8th row, every window, one vector of lanes at a time
+					const int lanes = (path == CompiledCascade::SIMD_AVX2) ? 8 : 4;
+					const int xEnd = level.image.cols - window.width;
+					for (int y = 0; y <= level.image.rows - window.height; y += 8) {
+						for (int x = 0; x + lanes - 1 <= xEnd; x += lanes) {
+							vector<int32_t> xs(lanes);
+							for (int l = 0; l < lanes; l++) xs[l] = x + l;
+							vector<double> expected = compiled->stageSums(level, y, xs, CompiledCascade::SIMD_NONE);
+							vector<double> found = compiled->stageSums(level, y, xs, (CompiledCascade::SimdLevel)path);
+							sampledWindows += lanes;
+							if (!sameSums(expected, found)) sumMismatches++;
+						}
+					}
+				}
+			}
+
+			CompiledCascade::groupCandidates(scalarRects, cascade.minNeighbors);
+			for (int path = CompiledCascade::SIMD_SSE41; path <= available; path++) {
+				CompiledCascade::groupCandidates(simdRects[path], cascade.minNeighbors);
+				if (simdRects[path] != scalarRects) rectMismatches++;
+			}
+		}
+
+		CHECK(sampledWindows > 0);
+		if (!CHECK(sumMismatches == 0 && levelMismatches == 0 && rectMismatches == 0)) {
+			startlog << "    " << cascade.path << " : " << sumMismatches << " stage sum mismatches / " << levelMismatches << " level mismatches / "
+				<< rectMismatches << " rect mismatches (" << sampledWindows << " windows sampled)" << endl << endlog;
+		}
+	}
+	CompiledCascade::simd = simd;
+	CHECK(stumpCascades > 0);
+}
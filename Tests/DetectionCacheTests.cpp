@@ -0,0 +1,105 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "Tests.h"
+#include "DetectionCache.h"
+#include "Image.h"
+
+using namespace std;
+using namespace cv;
+namespace fs = std::filesystem;
+
+// Rects of the four cascades : Empty lists included, like a negative image stores
+static vector<vector<Rect>> sampleRects(int offset) {
+	return { { Rect(10 + offset, 20, 100, 100) }, { Rect(30, 40, 20, 20), Rect(70, 40, 20, 20) }, {}, { Rect(offset, 0, 1, 1) } };
+}
+
+/// <summary>
+/// Keys are stored on disk, so they must not change between builds or runs : FNV-1a values are pinned,
+/// image keys depend on pixels and shape only (not on the Mat being a view), settings keys on the settings only.
+/// </summary>
+void testCacheKeyStability() {
+	CHECK(DetectionCache::hash("") == DetectionCache::hashSeed);
+	CHECK(DetectionCache::hash("a") == 0xaf63dc4c8601ec8cull);
+
+	uchar bytes[] = { 1, 2, 3, 4 };
+	Mat pixels = Mat(2, 2, CV_8UC1, bytes).clone();
+	CHECK(DetectionCache::hashImage(pixels) == 0xacea2c00852487edull);
+
+	// A view into a larger Mat hashes like its own copy
+	Mat larger(4, 4, CV_8UC1, Scalar(9));
+	Mat view = larger(Rect(1, 1, 2, 2));
+	pixels.copyTo(view);
+	CHECK(DetectionCache::hashImage(view) == DetectionCache::hashImage(pixels));
+	CHECK(DetectionCache::hashImage(pixels.reshape(1, 1)) != DetectionCache::hashImage(pixels)); // Same bytes, other shape
+
+	Mat changed = pixels.clone();
+	changed.at<uchar>(1, 1) = 5;
+	CHECK(DetectionCache::hashImage(changed) != DetectionCache::hashImage(pixels));
+
+	// Settings key : Equal for equal settings, any detection setting changes it, parallelCascades does not
+	Image first, second;
+	CHECK(first.settingsKey() == second.settingsKey());
+	second.parallelCascades = !first.parallelCascades;
+	CHECK(first.settingsKey() == second.settingsKey());
+	second.faceRegionEyes = !first.faceRegionEyes;
+	CHECK(first.settingsKey() != second.settingsKey());
+	second.faceRegionEyes = first.faceRegionEyes;
+	second.faceCascade.settings(1.2, 5, Size(40, 40));
+	CHECK(first.settingsKey() != second.settingsKey());
+}
+
+// Stored rects come back as stored, from this instance and from a new one opened on the same folder
+void testCacheRoundTrip() {
+	string folder = Tests::tempFolder("cache_round_trip");
+	vector<vector<Rect>> rects;
+	{
+		DetectionCache cache(folder, 0);
+		CHECK(cache.isValid());
+		CHECK(!cache.load(1, rects));
+		CHECK(cache.store(1, sampleRects(0)));
+		CHECK(cache.load(1, rects));
+		CHECK(rects == sampleRects(0));
+		CHECK(cache.stats().hits == 1 && cache.stats().misses == 1 && cache.stats().stores == 1);
+	}
+
+	DetectionCache reopened(folder, 0);
+	CHECK(reopened.stats().entries == 1);
+	CHECK(reopened.load(1, rects));
+	CHECK(rects == sampleRects(0));
+
+	// Replaced in place : Still one entry
+	CHECK(reopened.store(1, sampleRects(5)));
+	CHECK(reopened.load(1, rects) && rects == sampleRects(5));
+	CHECK(reopened.stats().entries == 1);
+}
+
+// Least recently used goes first : A hit makes an entry recent again, evicted entries lose their file
+void testCacheEviction() {
+	string folder = Tests::tempFolder("cache_eviction");
+	DetectionCache cache(folder, 0, 2);
+	vector<vector<Rect>> rects;
+
+	CHECK(cache.store(1, sampleRects(1)));
+	CHECK(cache.store(2, sampleRects(2)));
+	CHECK(cache.load(1, rects));                // 2 is now the oldest
+	CHECK(cache.store(3, sampleRects(3)));
+
+	CHECK(cache.stats().evictions == 1);
+	CHECK(cache.stats().entries == 2);
+	CHECK(!cache.load(2, rects));
+	CHECK(cache.load(1, rects) && rects == sampleRects(1));
+	CHECK(cache.load(3, rects) && rects == sampleRects(3));
+
+	size_t files = 0;
+	for (const auto& file : fs::directory_iterator(folder)) files += file.path().extension() == ".rects";
+	CHECK(files == 2);
+
+	// Byte limit : A cache reopened with a smaller one trims itself on open
+	size_t bytes = cache.stats().bytes;
+	DetectionCache smaller(folder, bytes - 1);
+	CHECK(smaller.stats().entries == 1);
+	CHECK(smaller.stats().bytes <= bytes - 1);
+}
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <filesystem>
+#include "Tests.h"
+#include "ProcessedIndex.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Input file with contents : Its path as the index keys it
+static string writeInput(const string& folder, const string& name, const string& contents) {
+	string path = (fs::path(folder) / name).string();
+	ofstream(path, ios::binary) << contents;
+	return path;
+}
+
+// Saved entries come back with their result, and unchanged() skips them until the contents change
+void testIndexRoundTrip() {
+	string folder = Tests::tempFolder("index_round_trip");
+	string indexPath = (fs::path(folder) / "index.txt").string();
+	string positive = writeInput(folder, "positive.jpg", "face");
+	string negative = writeInput(folder, "negative name.jpg", "no face"); // Paths may contain spaces
+	string failed = writeInput(folder, "failed.jpg", "broken");
+	{
+		ProcessedIndex index;
+		CHECK(index.load(indexPath, 1));
+		CHECK(!index.existed());
+		CHECK(index.record(positive, ProcessedIndex::POSITIVE));
+		CHECK(index.record(negative, ProcessedIndex::NEGATIVE));
+		CHECK(index.record(failed, ProcessedIndex::POSITIVE));
+		index.fail(failed);
+		CHECK(index.save());
+	}
+
+	ProcessedIndex index;
+	CHECK(index.load(indexPath, 1));
+	CHECK(index.existed());
+	CHECK(index.size() == 3);
+	CHECK(index.contains(positive) && index.contains(negative) && index.contains(failed));
+	CHECK(index.unchanged(fs::directory_entry(positive)));
+	CHECK(index.unchanged(fs::directory_entry(negative)));
+	CHECK(!index.unchanged(fs::directory_entry(failed))); // Failed inputs always run again
+
+	writeInput(folder, "positive.jpg", "other face");
+	CHECK(!index.unchanged(fs::directory_entry(positive)));
+}
+
+// A different detection settings key drops NEGATIVE entries (and only them), the same key keeps everything
+void testIndexSettingsChange() {
+	string folder = Tests::tempFolder("index_settings");
+	string indexPath = (fs::path(folder) / "index.txt").string();
+	string positive = writeInput(folder, "positive.jpg", "face");
+	string negative = writeInput(folder, "negative.jpg", "no face");
+	{
+		ProcessedIndex index;
+		index.load(indexPath, 1);
+		index.record(positive, ProcessedIndex::POSITIVE);
+		index.record(negative, ProcessedIndex::NEGATIVE);
+		CHECK(index.save());
+	}
+	{
+		ProcessedIndex index;
+		CHECK(index.load(indexPath, 1));
+		CHECK(index.contains(negative));
+	}
+
+	ProcessedIndex changed;
+	CHECK(changed.load(indexPath, 2));
+	CHECK(changed.contains(positive));
+	CHECK(!changed.contains(negative));
+	CHECK(changed.save());
+
+	// Saved under the new key : Loading with it again keeps what is left
+	ProcessedIndex reloaded;
+	CHECK(reloaded.load(indexPath, 2));
+	CHECK(reloaded.size() == 1 && reloaded.contains(positive));
+}
+
+// Entries the scan did not list are dropped for the scanned folder only (sub folders when recursive)
+void testIndexPrune() {
+	string folder = Tests::tempFolder("index_prune");
+	fs::create_directories(fs::path(folder) / "sub");
+	string indexPath = (fs::path(folder) / "index.txt").string();
+	string listed = writeInput(folder, "listed.jpg", "a");
+	string deleted = writeInput(folder, "deleted.jpg", "b");
+	string nested = writeInput(folder, "sub/nested.jpg", "c");
+
+	ProcessedIndex index;
+	index.load(indexPath, 1);
+	index.record(listed, ProcessedIndex::POSITIVE);
+	index.record(deleted, ProcessedIndex::POSITIVE);
+	index.record(nested, ProcessedIndex::POSITIVE);
+	CHECK(index.save());
+
+	ProcessedIndex reloaded;
+	reloaded.load(indexPath, 1);
+	CHECK(reloaded.unchanged(fs::directory_entry(listed))); // Marks it seen, like the input scan
+	CHECK(reloaded.prune(folder, false) == 1);
+	CHECK(reloaded.contains(listed) && !reloaded.contains(deleted));
+	CHECK(reloaded.contains(nested)); // Not in the scanned folder without recursion
+	CHECK(reloaded.prune(folder, true) == 1);
+	CHECK(!reloaded.contains(nested));
+}
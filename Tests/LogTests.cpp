@@ -0,0 +1,61 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "Tests.h"
+#include "Log.h"
+
+using namespace std;
+
+// Waits at most timeout for done : A hung flush() cannot be joined, so the process ends there with the failure reported
+static void expectReturns(future<void>& done, const char* what, streambuf* console) {
+	if (done.wait_for(chrono::seconds(20)) == future_status::ready) return;
+	cout.rdbuf(console);
+	cout << "[FAIL] " << what << " did not return" << endl;
+	_Exit(1);
+}
+
+/// <summary>
+/// Many producers log while another thread keeps calling flush() : Every flush() returns, a final flush() returns once
+/// everything is written, and every line reaches cout exactly once.
+/// Short bursts over many rounds : The writer often drains a message the moment it is linked, the ordering flush() depends on.
+/// </summary>
+void testLogFlushUnderLoad() {
+	const int rounds = 2000, producers = 8, messages = 16;
+
+	// Only the writer thread touches cout while async : Swapped for a buffer once it is idle
+	Log::flush();
+	ostringstream captured;
+	streambuf* console = cout.rdbuf(captured.rdbuf());
+
+	atomic<bool> producing = true;
+	future<void> flusher = async(launch::async, [&]() {
+		while (producing) Log::flush();
+	});
+
+	for (int round = 0; round < rounds; round++) {
+		vector<thread> threads;
+		for (int producer = 0; producer < producers; producer++) {
+			threads.emplace_back([producer]() {
+				for (int i = 0; i < messages; i++) Log::print(to_string(producer) + "\n", LOG_DEFAULT);
+			});
+		}
+		for (thread& thread : threads) thread.join();
+
+		// Everything of this round is written once flush() returns
+		future<void> flushed = async(launch::async, []() { Log::flush(); });
+		expectReturns(flushed, "flush() after a burst", console);
+	}
+	producing = false;
+	expectReturns(flusher, "flush() racing the producers", console);
+	cout.rdbuf(console);
+
+	string text = captured.str();
+	CHECK(count(text.begin(), text.end(), '\n') == (long long)rounds * producers * messages);
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include "Tests.h"
+#include "BoundedQueue.h"
+
+using namespace std;
+
+// Still waiting after a moment : The call is blocked on the queue
+template <typename T>
+static bool blocked(future<T>& call) {
+	return call.wait_for(chrono::milliseconds(100)) == future_status::timeout;
+}
+
+// Waits at most timeout for call : A hung call cannot be joined, so the process ends there with the failure reported
+template <typename T>
+static T expectReturns(future<T>& call, const char* what) {
+	if (call.wait_for(chrono::seconds(20)) != future_status::ready) {
+		cout << "[FAIL] " << what << " did not return" << endl;
+		_Exit(1);
+	}
+	return call.get();
+}
+
+/// <summary>
+/// close() on a BoundedQueue : Blocked pop() and push() wake, later push() fails, and pop() drains what was queued before returning false.
+/// </summary>
+void testQueueCloseDrains() {
+	// A consumer waiting on an empty queue wakes and gets nothing
+	BoundedQueue<int> empty("empty", 2);
+	future<bool> waitingPop = async(launch::async, [&]() { int item; return empty.pop(item); });
+	CHECK(blocked(waitingPop));
+	empty.close();
+	CHECK(!expectReturns(waitingPop, "pop() on a closed empty queue"));
+
+	// A producer waiting on a full queue wakes and its item is dropped
+	BoundedQueue<int> queue("drain", 2);
+	CHECK(queue.push(1));
+	CHECK(queue.push(2));
+	future<bool> waitingPush = async(launch::async, [&]() { return queue.push(3); });
+	CHECK(blocked(waitingPush));
+	queue.close();
+	CHECK(!expectReturns(waitingPush, "push() on a closed full queue"));
+	CHECK(!queue.push(4));
+
+	// Items queued before close() still come out, in order
+	int item = 0;
+	CHECK(queue.pop(item) && item == 1);
+	CHECK(queue.pop(item) && item == 2);
+	CHECK(!queue.pop(item));
+	CHECK(queue.stats().items == 2);
+}
+
+/// <summary>
+/// tryPush() never waits : A full queue rejects the item, leaves it with the caller and counts it, a closed one rejects it without counting.
+/// </summary>
+void testQueueTryPush() {
+	BoundedQueue<string> queue("tryPush", 2);
+	string first = "first", second = "second", third = "third";
+	CHECK(queue.tryPush(first));
+	CHECK(queue.tryPush(second));
+	CHECK(!queue.tryPush(third));
+	CHECK(third == "third");
+	CHECK(queue.stats().rejected == 1);
+
+	// Room again after a pop
+	string item;
+	CHECK(queue.pop(item) && item == "first");
+	CHECK(queue.tryPush(third));
+
+	queue.close();
+	string late = "late";
+	CHECK(!queue.tryPush(late));
+	CHECK(late == "late");
+
+	QueueStats stats = queue.stats();
+	CHECK(stats.rejected == 1);
+	CHECK(stats.items == 3);
+	CHECK(stats.maxDepth == 2);
+}
+
+/// <summary>
+/// OrderedQueue : Indices pushed out of order from several threads pop strictly in order, a push capacity or more ahead waits
+/// for the pops to catch up, and pop() returns false once close(count) is reached.
+/// </summary>
+void testOrderedQueueOrder() {
+	const size_t count = 2000, capacity = 8;
+	const int producers = 4;
+
+	// Ahead of the window : Waits until the next index is popped
+	OrderedQueue<size_t> window("window", 2);
+	future<void> ahead = async(launch::async, [&]() { window.push(2, 2); });
+	CHECK(blocked(ahead));
+	window.push(1, 1);
+	window.push(0, 0);
+	size_t item = SIZE_MAX;
+	CHECK(window.pop(item) && item == 0);
+	expectReturns(ahead, "push() once the window moved");
+	CHECK(window.pop(item) && item == 1);
+	CHECK(window.pop(item) && item == 2);
+	window.close(3);
+	CHECK(!window.pop(item));
+
+	// Each producer takes every producers-th index, shuffled within small runs so pushes arrive out of order
+	OrderedQueue<size_t> queue("ordered", capacity);
+	vector<thread> threads;
+	for (int producer = 0; producer < producers; producer++) {
+		threads.emplace_back([&, producer]() {
+			mt19937 random(producer);
+			vector<size_t> indices;
+			for (size_t index = producer; index < count; index += producers) indices.push_back(index);
+			for (size_t run = 0; run < indices.size(); run += 2) {
+				size_t end = min(run + 2, indices.size());
+				shuffle(indices.begin() + run, indices.begin() + end, random);
+			}
+			for (size_t index : indices) queue.push(index, index);
+		});
+	}
+
+	future<size_t> consumer = async(launch::async, [&]() {
+		size_t popped = 0, value = 0;
+		while (queue.pop(value)) {
+			if (value != popped) return SIZE_MAX;
+			popped++;
+		}
+		return popped;
+	});
+	for (thread& thread : threads) thread.join();
+	queue.close(count);
+	CHECK(expectReturns(consumer, "pop() through the reorder buffer") == count);
+	CHECK(queue.stats().maxDepth <= capacity);
+}
@@ -0,0 +1,82 @@
+/* ------------------------------ Steve Harvey Image Generator ------------------------------ */
+/* ------------------------------------------ Tests ------------------------------------------ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "Tests.h"
+#include "Log.h"
+
+#define endlog Log::printStream()
+
+/* ---------------------------------------- Headers ---------------------------------------- */
+
+struct TestCase {
+	const char* name;
+	void (*run)();
+};
+
+// Every test, in run order : Names are matched by the command line filters
+static const TestCase testCases[] = {
+	{ "log.flushUnderLoad", testLogFlushUnderLoad },
+	{ "queue.closeDrains", testQueueCloseDrains },
+	{ "queue.tryPush", testQueueTryPush },
+	{ "queue.orderedOrder", testOrderedQueueOrder },
+	{ "index.roundTrip", testIndexRoundTrip },
+	{ "index.settingsChange", testIndexSettingsChange },
+	{ "index.prune", testIndexPrune },
+	{ "cache.keyStability", testCacheKeyStability },
+	{ "cache.roundTrip", testCacheRoundTrip },
+	{ "cache.eviction", testCacheEviction },
+	{ "compiled.matchesOpenCV", testCompiledMatchesOpenCV },
+	{ "compiled.rejectsBadBinary", testCompiledRejectsBadBinary },
+	{ "compiled.simdMatchesScalar", testCompiledSimdMatchesScalar },
+};
+
+int Tests::failures = 0;
+
+/* ---------------------------------------- Main ---------------------------------------- */
+
+int main(int argc, char** argv) {
+	using namespace std;
+
+	// No filter = Every test : Otherwise tests whose name contains any filter
+	vector<string> filters(argv + 1, argv + argc);
+	int passed = 0, failed = 0;
+	for (const TestCase& test : testCases) {
+		string name = test.name;
+		bool selected = filters.empty();
+		for (const string& filter : filters) selected = selected || name.find(filter) != string::npos;
+		if (!selected) continue;
+
+		Tests::failures = 0;
+		test.run();
+		if (Tests::failures) failed++;
+		else passed++;
+		startlog << (Tests::failures ? "[FAIL] " : "[PASS] ") << name << endl << endlog;
+	}
+	startlog << "----------------------------------------" << endl << "Tests : [" << passed << " Passed] [" << failed << " Failed]" << endl << endlog;
+	Log::stop();
+	return failed ? 1 : 0;
+}
+
+/* ---------------------------------------- Functions ---------------------------------------- */
+
+bool Tests::check(bool passed, const char* condition, const char* file, int line) {
+	if (!passed) {
+		failures++;
+		startlog << "    " << file << ":" << line << " : CHECK(" << condition << ") failed" << endl << endlog;
+	}
+	return passed;
+}
+
+// Empty folder for one test's files under the system temp folder : Left behind for inspection until the next run
+string Tests::tempFolder(const string& name) {
+	namespace fs = std::filesystem;
+	fs::path folder = fs::temp_directory_path() / "heve_tests" / name;
+	error_code error;
+	fs::remove_all(folder, error);
+	fs::create_directories(folder, error);
+	return folder.string();
+}
@@ -0,0 +1,42 @@
+#include <iostream>
+#include <string>
+
+#pragma once
+
+using namespace std;
+
+// CHECK(condition) : A false condition is reported with its file and line and fails the running test, which carries on
+#define CHECK(condition) Tests::check((condition), #condition, __FILE__, __LINE__)
+
+/// <summary>
+/// Regression tests for the generator's modules : Each one is a plain function listed in Tests.cpp.
+/// Run from the OpenCVProject folder (the Resources paths are relative to it) : "Tests [name filter ...]", exit code 1 if any check failed.
+/// </summary>
+struct Tests {
+    static int failures;            // Failed checks of the running test
+    static bool check(bool passed, const char* condition, const char* file, int line);
+    static string tempFolder(const string& name);
+};
+
+// ---- Log ---- //
+void testLogFlushUnderLoad();
+
+// ---- BoundedQueue ---- //
+void testQueueCloseDrains();
+void testQueueTryPush();
+void testOrderedQueueOrder();
+
+// ---- ProcessedIndex ---- //
+void testIndexRoundTrip();
+void testIndexSettingsChange();
+void testIndexPrune();
+
+// ---- DetectionCache ---- //
+void testCacheKeyStability();
+void testCacheRoundTrip();
+void testCacheEviction();
+
+// ---- CompiledCascade ---- //
+void testCompiledMatchesOpenCV();
+void testCompiledRejectsBadBinary();
+void testCompiledSimdMatchesScalar();